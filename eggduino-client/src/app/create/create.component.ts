@@ -8,6 +8,7 @@ import { TransformsService } from './services/transforms';
 import { CodeConverter as CodeConverter } from '../shared/code-convert';
 import { ApiService } from '../shared/api.service';
 import { PresentationService } from '../shared/presentation.service';
+import { WebSocketService } from '../shared/ws.service';
 import { Router, ActivatedRoute } from '@angular/router';
 import { ImageTracer } from './services/image-tracer';
 
@@ -41,6 +42,7 @@ export class CreateComponent implements OnInit, OnDestroy {
     private cdr: ChangeDetectorRef,
     private presentationService: PresentationService,
     private router: Router,
+    private ws: WebSocketService,
   ) {
     this.file = this.router.getCurrentNavigation().extras?.state?.file;
 
@@ -208,16 +210,37 @@ export class CreateComponent implements OnInit, OnDestroy {
         }
       });
     } catch (error) {
+      // a job the printer would not read as written says where
+      const rejected = error.error?.line;
       this.presentationService
         .showInformation({
           title: 'Error',
-          message: `Error during save. Possible duplicate filename.\n${error.message}`
+          message: rejected
+            ? `The job is not valid, line ${rejected}: ${error.error.error}.`
+            : `Error during save. Possible duplicate filename.\n${error.message}`
         })
         .toPromise();
       this.name.nativeElement.focus();
     }
   }
 
+  async print() {
+    const code = this.codeConverter.layersToCode(this.visibleLayers);
+    const name = this.name.nativeElement.innerText;
+
+    // outlives this page, the print stops if the browser goes away
+    this.ws.streamPrint(name, code).subscribe({
+      error: error => this.presentationService
+        .showInformation({
+          title: 'Error',
+          message: `Error while sending the print.\n${error.message}`
+        })
+        .subscribe(),
+    });
+
+    await this.router.navigate(['print']);
+  }
+
   cancel() {
     this.router.navigate(['print']);
   }
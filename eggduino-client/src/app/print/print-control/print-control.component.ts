@@ -17,11 +17,17 @@ export class PrintControlComponent implements OnInit, OnDestroy {
   private destroy$ = new Subject();
 
   layers$ = this.ws.status$.pipe(
-    map(s => s.fileName),
-    distinctUntilChanged(),
-    switchMap(fileName => fileName
-      ? this.apiService.loadFile(fileName).pipe(map(data => this.codeConvert.codeToLayers(data)))
-      : of([] as Layer[])),
+    distinctUntilChanged((a, b) => a.fileName === b.fileName && a.streaming === b.streaming),
+    switchMap(({ fileName, streaming }) => {
+      if (streaming) {
+        // not on the printer, shown from what was sent if it was this browser
+        const job = this.ws.streamedJob;
+        return of(job?.name === fileName ? this.codeConvert.codeToLayers(job.code) : []);
+      }
+      return fileName
+        ? this.apiService.loadFile(fileName).pipe(map(data => this.codeConvert.codeToLayers(data)))
+        : of([] as Layer[]);
+    }),
   );
 
   progress$ = this.ws.status$.pipe(
@@ -29,6 +35,21 @@ export class PrintControlComponent implements OnInit, OnDestroy {
     distinctUntilChanged()
   );
 
+  position$ = this.ws.status$.pipe(
+    map(s => s.position),
+    distinctUntilChanged()
+  );
+
+  eta$ = this.ws.status$.pipe(
+    map(s => s.status === 'stopped' ? '' : this.formatTime(s.eta)),
+    distinctUntilChanged()
+  );
+
+  feedOverride$ = this.ws.status$.pipe(
+    map(s => s.feedOverride),
+    distinctUntilChanged()
+  );
+
   progressPercent = 0;
   status: 'printing' | 'paused' | 'stopped';
   get primaryLabel() {
@@ -48,8 +69,11 @@ export class PrintControlComponent implements OnInit, OnDestroy {
       map(layers => ({ layers, totalTravel: this.getTravel(layers) }))
     );
 
-    combineLatest([layersTotalTravel$, this.progress$]).pipe(
-      map(([{ layers, totalTravel }, currentLine]) => {
+    combineLatest([layersTotalTravel$, this.progress$, this.ws.status$]).pipe(
+      map(([{ layers, totalTravel }, currentLine, { percent }]) => {
+        if (percent) {
+          return percent;
+        }
         const currentTravel = this.getTravel(layers, currentLine);
         return Math.round(currentTravel / totalTravel * 1000) / 10;
       }),
@@ -70,15 +94,27 @@ export class PrintControlComponent implements OnInit, OnDestroy {
     });
 
     this.ws.status$.pipe(
-      switchMap(s => s.status === 'paused' && s.waitingFor?.length > 0
-        ? this.presentationService.showConfirmation({
-          title: 'Switch pen',
-          message: `Switch pen for layer '${s.waitingFor}' and press continue when done.\nOr press stop to stop the print.`,
-          okMessage: 'Continue',
-          noMessage: 'Stop',
-          disableClose: true,
-        })
-        : EMPTY
+      distinctUntilChanged((a, b) => a.status === b.status &&
+        a.confirmStart === b.confirmStart && a.waitingFor === b.waitingFor),
+      switchMap(s => s.status !== 'paused'
+        ? EMPTY
+        : s.confirmStart
+          ? this.presentationService.showConfirmation({
+            title: 'Next egg',
+            message: `Place the next egg and press continue (or a button on the printer) to print it.\nOr press stop to stop the print.`,
+            okMessage: 'Continue',
+            noMessage: 'Stop',
+            disableClose: true,
+          })
+          : s.waitingFor?.length > 0
+            ? this.presentationService.showConfirmation({
+              title: 'Switch pen',
+              message: `Switch pen for layer '${s.waitingFor}' and press continue when done.\nOr press stop to stop the print.`,
+              okMessage: 'Continue',
+              noMessage: 'Stop',
+              disableClose: true,
+            })
+            : EMPTY
       ),
       switchMap(_ => this.apiService.sendCommand('print-continue')),
       retryWhen(err$ => err$.pipe(
@@ -101,6 +137,10 @@ export class PrintControlComponent implements OnInit, OnDestroy {
     await this.apiService.sendCommand(this.status === 'printing' ? 'print-pause' : 'print-continue').toPromise();
   }
 
+  async setFeedOverride(feed: number) {
+    await this.apiService.setFeedOverride(feed).toPromise();
+  }
+
   async stopPrint(skipConfirmation = false) {
     try {
       await concat(
@@ -128,6 +168,16 @@ export class PrintControlComponent implements OnInit, OnDestroy {
     }
   }
 
+  private formatTime(seconds: number) {
+    if (!seconds) {
+      return '';
+    }
+    const h = Math.floor(seconds / 3600);
+    const m = Math.floor(seconds / 60) % 60;
+    const s = seconds % 60;
+    return h > 0 ? `${h}h ${m}m left` : `${m}m ${s}s left`;
+  }
+
   private getTravel(layers: Layer[], upToLine?: number) {
     let lastPoint: Point = HOME;
     let travel = 0;
@@ -0,0 +1,76 @@
+import { Component, ChangeDetectionStrategy } from '@angular/core';
+import { Observable } from 'rxjs';
+import { switchMap } from 'rxjs/operators';
+import { ApiService, PrintQueue, PrintQueueEntry } from 'src/app/shared/api.service';
+import { WebSocketService } from 'src/app/shared/ws.service';
+import { PresentationService, Cancel } from 'src/app/shared/presentation.service';
+
+@Component({
+  selector: 'app-print-queue',
+  templateUrl: './print-queue.component.html',
+  styleUrls: ['./print-queue.component.scss'],
+  changeDetection: ChangeDetectionStrategy.OnPush
+})
+export class PrintQueueComponent {
+  queue$ = this.ws.queue$;
+
+  constructor(
+    private apiService: ApiService,
+    private ws: WebSocketService,
+    private presentationService: PresentationService,
+  ) {
+  }
+
+  // the job printing stays first until it is done
+  isActive(queue: PrintQueue, index: number) {
+    return queue.running && index === 0;
+  }
+
+  canMove(queue: PrintQueue, index: number, position: number) {
+    return position >= 0 && !this.isActive(queue, index) && !this.isActive(queue, position);
+  }
+
+  async move(index: number, position: number) {
+    await this.run(this.apiService.updateQueueEntry(index, { position }));
+  }
+
+  async remove(index: number) {
+    await this.run(this.apiService.removeQueueEntry(index));
+  }
+
+  async setCopies(index: number, job: PrintQueueEntry) {
+    await this.run(this.presentationService.showInput({
+      title: job.name,
+      message: `${job.printed} printed so far`,
+      inputLabel: 'Copies',
+      inputType: 'number',
+    }).pipe(
+      switchMap(copies => this.apiService.updateQueueEntry(index, { copies: +copies })),
+    ));
+  }
+
+  async setConfirm(confirm: boolean) {
+    await this.run(this.apiService.updateQueue({ confirm }));
+  }
+
+  async setRunning(running: boolean) {
+    await this.run(this.apiService.updateQueue({ running }));
+  }
+
+  trackJob(index: number, job: PrintQueueEntry) {
+    return `${index}:${job.name}`;
+  }
+
+  private async run(action: Observable<unknown>) {
+    try {
+      await action.toPromise();
+    } catch (err) {
+      if (err !== Cancel) {
+        await this.presentationService.showInformation({
+          title: 'Error',
+          message: `Could not change the queue\n${err.message}`,
+        }).toPromise();
+      }
+    }
+  }
+}
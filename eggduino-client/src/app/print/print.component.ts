@@ -1,6 +1,6 @@
 import { Component, OnInit, ChangeDetectionStrategy, ChangeDetectorRef, OnDestroy } from '@angular/core';
 import { ApiService, PrintFile } from '../shared/api.service';
-import { map, distinctUntilChanged, takeUntil } from 'rxjs/operators';
+import { map, distinctUntilChanged, takeUntil, filter, take, switchMap } from 'rxjs/operators';
 import { Observable, Subject, concat, defer, EMPTY, race } from 'rxjs';
 import { Layer } from '../utils';
 import { CodeConverter } from '../shared/code-convert';
@@ -31,6 +31,8 @@ export class PrintComponent implements OnInit, OnDestroy {
     })),
   );
 
+  checkpoint$ = this.apiService.checkpoint();
+
   isPrinting$ = this.ws.status$.pipe(
     map(s => s.status !== 'stopped'),
     distinctUntilChanged(),
@@ -106,6 +108,53 @@ export class PrintComponent implements OnInit, OnDestroy {
     await this.apiService.printFile(file.name).toPromise();
   }
 
+  async enqueueFile(file: PrintFile) {
+    try {
+      await this.presentationService.showInput({
+        title: 'Add to queue',
+        message: `How many eggs of '${file.name}'?`,
+        inputLabel: 'Copies',
+        inputType: 'number',
+      }).pipe(
+        switchMap(copies => this.apiService.enqueue(file.name, +copies)),
+        takeUntil(this.destroy$),
+      ).toPromise();
+      this.presentationService.showToast('Added to the queue');
+    } catch (err) {
+      if (err !== CANCEL) {
+        await this.presentationService
+          .showInformation({
+            title: 'Error',
+            message: `Could not add the file to the queue\n${err.message}`,
+          })
+          .toPromise();
+      }
+    }
+  }
+
+  async optimizeFile(file: PrintFile) {
+    const { name } = await this.apiService.optimizeFile(file.name).toPromise();
+    this.presentationService.showToast('Optimizing travel...');
+    const result = await this.ws.messages$.pipe(
+      filter(m => m.optimized === name),
+      take(1),
+      takeUntil(this.destroy$),
+    ).toPromise();
+    if (result?.ok) {
+      const files = await this.apiService.files$.pipe(take(1)).toPromise();
+      if (!files.some(f => f.name === name)) {
+        this.apiService.addFile(name);
+      }
+      this.presentationService.showToast(`Saved as '${name}'`);
+    } else if (result) {
+      this.presentationService.showToast('Could not optimize the file');
+    }
+  }
+
+  async resumePrint() {
+    await this.apiService.resumePrint().toPromise();
+  }
+
   trackFile(_: number, file: PrintFile) {
     return file.name;
   }
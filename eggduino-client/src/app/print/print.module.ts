@@ -5,13 +5,14 @@ import { MatProgressBarModule } from '@angular/material/progress-bar';
 import { PrintComponent } from './print.component';
 import { SharedModule } from '../shared/shared.module';
 import { PrintControlComponent } from './print-control/print-control.component';
+import { PrintQueueComponent } from './print-queue/print-queue.component';
 
 const routes: Routes = [
   { path: '', component: PrintComponent }
 ];
 
 @NgModule({
-  declarations: [PrintComponent, PrintControlComponent],
+  declarations: [PrintComponent, PrintControlComponent, PrintQueueComponent],
   imports: [
     SharedModule, MatProgressBarModule,
     RouterModule.forChild(routes),
@@ -135,6 +135,57 @@ export class ApiService {
         );
     }
 
+    queue() {
+        return this.client.get<PrintQueue>('api/queue');
+    }
+
+    enqueue(name: string, copies: number) {
+        return race(
+            this.client.post('api/queue/' + name, `copies=${copies}`, {
+                responseType: 'text',
+                headers: new HttpHeaders().append('Content-Type', 'application/x-www-form-urlencoded'),
+            }),
+            this.presentationService.globalLoader,
+        ).pipe(ignoreElements());
+    }
+
+    updateQueue(params: { running?: boolean, confirm?: boolean }) {
+        return this.patchForm('api/queue', params);
+    }
+
+    updateQueueEntry(index: number, params: { position?: number, copies?: number }) {
+        return this.patchForm('api/queue/' + index, params);
+    }
+
+    removeQueueEntry(index: number) {
+        return race(
+            this.client.delete('api/queue/' + index, { responseType: 'text' }),
+            this.presentationService.globalLoader,
+        ).pipe(ignoreElements());
+    }
+
+    optimizeFile(name: string) {
+        return race(
+            this.client.post<{ name: string }>('api/optimize/' + name, ''),
+            this.presentationService.globalLoader
+        );
+    }
+
+    addFile(name: string) {
+        this.events$.next({ type: 'create', name });
+    }
+
+    checkpoint() {
+        return this.client.get<Checkpoint>('api/resume').pipe(catchError(_ => of(null as Checkpoint)));
+    }
+
+    resumePrint() {
+        return race(
+            this.client.post('api/resume', '', { responseType: 'text' }),
+            this.presentationService.globalLoader
+        );
+    }
+
 
     updateConfig(config: Config) {
         this.updateConfig$.next(config);
@@ -153,18 +204,12 @@ export class ApiService {
         ).pipe(ignoreElements());
     }
 
+    setFeedOverride(feed: number) {
+        return this.patchForm('api/override', { feed });
+    }
+
     updateMotionParams(params: MotionParams) {
-        const url = new URLSearchParams();
-        for (const [key, value] of Object.entries(params)) {
-            url.append(key, `${value}`);
-        }
-        return race(
-            this.client.patch('api/motion', url.toString(), {
-                responseType: 'text',
-                headers: new HttpHeaders().append('Content-Type', 'application/x-www-form-urlencoded'),
-            }),
-            this.presentationService.globalLoader,
-        ).pipe(ignoreElements());
+        return this.patchForm('api/motion', params);
     }
 
     wifiScan() {
@@ -188,6 +233,20 @@ export class ApiService {
         );
     }
 
+    private patchForm(path: string, params: object) {
+        const url = new URLSearchParams();
+        for (const [key, value] of Object.entries(params)) {
+            url.append(key, `${value}`);
+        }
+        return race(
+            this.client.patch(path, url.toString(), {
+                responseType: 'text',
+                headers: new HttpHeaders().append('Content-Type', 'application/x-www-form-urlencoded'),
+            }),
+            this.presentationService.globalLoader,
+        ).pipe(ignoreElements());
+    }
+
     private getCacheKey(fileName: string) {
         return `file:${fileName}`;
     }
@@ -207,17 +266,55 @@ export enum EncryptionType {
 
 export interface PrintFile {
     name: string;
+    size?: number;
+    modified?: number;
+    lines?: number;
+    duration?: number;
+    penLifts?: number;
+    // degrees
+    drawDistance?: number;
+    travelDistance?: number;
+    // minX, minY, maxX, maxY in degrees
+    bounds?: [number, number, number, number];
+    // from the S lines
+    layerNames?: string[];
+}
+
+export interface Checkpoint {
+    fileName: string;
+    line: number;
+}
+
+export interface PrintQueueEntry {
+    name: string;
+    copies: number;
+    printed: number;
+}
+
+export interface PrintQueue {
+    running: boolean;
+    confirm: boolean;
+    jobs: PrintQueueEntry[];
 }
 
 export interface MotionParams {
     penUpPercent: number;
     penDownPercent: number;
     drawingSpeed: number;
-    penMoveDelay: number;
+    penUpDelay: number;
+    penDownDelay: number;
+    penOverlap: number;
     travelSpeed: number;
     stepsPerRotation: number;
     reversePen: boolean;
     reverseRotation: boolean;
+    acceleration: number;
+    junctionDeviation: number;
+    startSpeed: number;
+    wrapDrawing: boolean;
+    pathTolerance: number;
+    maxDrawingSpeed: number;
+    straightRun: number;
 }
 
 export interface Config {
@@ -2,7 +2,7 @@ import { Component, Input, OnDestroy, ElementRef, OnInit, ChangeDetectionStrateg
 
 import {
   Scene, Mesh, WebGLRenderer, Texture, MathUtils, GridHelper,
-  PerspectiveCamera, AmbientLight, DirectionalLight, MeshStandardMaterial, TextureLoader, Color
+  PerspectiveCamera, AmbientLight, DirectionalLight, MeshStandardMaterial, TextureLoader, Color, MeshBasicMaterial
 } from 'three';
 import { OrbitControls } from 'three/examples/jsm/controls/OrbitControls';
 import { GUI } from 'dat.gui';
@@ -10,6 +10,13 @@ import { GUI } from 'dat.gui';
 import { STEPS_PER_REV, DEFAULT_LAYER_COLORS, Layer, allMatches, Point, HOME } from 'src/app/utils';
 import ResizeObserver from 'resize-observer-polyfill';
 import { createGui, createGeometry } from './options';
+import { HeadPosition } from '../ws.service';
+
+// the pen marker is drawn on a texture of its own, over the drawing
+const HEAD_TEXTURE_SIZE = 1024;
+const HEAD_RADIUS = 10;
+// a sample is animated to over the time since the one before, at most this long, ms
+const HEAD_MAX_ANIMATION = 1000;
 
 @Component({
   selector: 'app-preview',
@@ -24,6 +31,19 @@ export class PreviewComponent implements OnInit, OnDestroy {
   private layersInternal: Layer[];
   private lineNumberInternal: number | undefined;
   private resizeObserver: ResizeObserver;
+  // the pen marker, shown moving from one sample to the next since start for duration ms
+  private marker = {
+    from: null as HeadPosition,
+    to: null as HeadPosition,
+    start: 0,
+    duration: 0,
+    drawn: false,
+  };
+  private markerView: {
+    ctx: CanvasRenderingContext2D;
+    texture: Texture;
+    mesh: Mesh;
+  };
   private three: {
     camera: PerspectiveCamera;
     scene: Scene;
@@ -49,6 +69,17 @@ export class PreviewComponent implements OnInit, OnDestroy {
     }
   }
 
+  @Input()
+  set head(value: HeadPosition | null) {
+    const now = performance.now();
+    const marker = this.marker;
+    marker.from = value && marker.to ? this.markerAt(now) : value;
+    marker.duration = marker.start ? Math.min(now - marker.start, HEAD_MAX_ANIMATION) : 0;
+    marker.start = now;
+    marker.to = value;
+    marker.drawn = false;
+  }
+
   @Input()
   showTravel = false;
 
@@ -145,9 +176,67 @@ export class PreviewComponent implements OnInit, OnDestroy {
 
     const mesh = new Mesh(createGeometry(), material);
     mesh.rotateY(MathUtils.degToRad(180));
+    mesh.add(this.createMarkerMesh(mesh));
+    return mesh;
+  }
+
+  private createMarkerMesh(egg: Mesh) {
+    const canvas = document.createElement('canvas');
+    canvas.width = HEAD_TEXTURE_SIZE;
+    canvas.height = HEAD_TEXTURE_SIZE;
+    const texture = new Texture(canvas);
+    const mesh = new Mesh(egg.geometry, new MeshBasicMaterial({ map: texture, transparent: true, depthWrite: false }));
+    // just above the drawing
+    mesh.scale.setScalar(1.003);
+    this.markerView = { ctx: canvas.getContext('2d'), texture, mesh };
     return mesh;
   }
 
+  private markerAt(now: number): HeadPosition {
+    const { from, to, start, duration } = this.marker;
+    const t = duration ? Math.min((now - start) / duration, 1) : 1;
+    if (t >= 1) {
+      return to;
+    }
+    // the egg turns the shorter way round
+    const dx = ((to.x - from.x) % STEPS_PER_REV + STEPS_PER_REV * 1.5) % STEPS_PER_REV - STEPS_PER_REV / 2;
+    return {
+      x: (from.x + dx * t + STEPS_PER_REV) % STEPS_PER_REV,
+      y: from.y + (to.y - from.y) * t,
+      penHeight: from.penHeight + (to.penHeight - from.penHeight) * t,
+      moving: to.moving,
+    };
+  }
+
+  private drawMarker(now: number) {
+    const marker = this.marker;
+    const animating = marker.to && now - marker.start < marker.duration;
+    if (marker.drawn && !animating) {
+      return;
+    }
+    marker.drawn = true;
+
+    const { ctx, texture } = this.markerView;
+    ctx.clearRect(0, 0, HEAD_TEXTURE_SIZE, HEAD_TEXTURE_SIZE);
+    if (marker.to) {
+      // the same mapping as the drawing, in pixels so the marker stays round
+      const position = this.markerAt(now);
+      const x = position.x / STEPS_PER_REV * HEAD_TEXTURE_SIZE;
+      const y = HEAD_TEXTURE_SIZE / 2 + position.y / STEPS_PER_REV * 2 * HEAD_TEXTURE_SIZE;
+      ctx.lineWidth = 3;
+      ctx.strokeStyle = 'black';
+      // filled as it comes down onto the egg
+      ctx.fillStyle = `rgba(255, 64, 0, ${1 - position.penHeight})`;
+      for (const offset of [-HEAD_TEXTURE_SIZE, 0, HEAD_TEXTURE_SIZE]) {
+        ctx.beginPath();
+        ctx.arc(x + offset, y, HEAD_RADIUS, 0, 2 * Math.PI);
+        ctx.fill();
+        ctx.stroke();
+      }
+    }
+    texture.needsUpdate = true;
+  }
+
   private switchStrokeToTransparent() {
     this.ctx.save();
     this.ctx.resetTransform();
@@ -261,6 +350,9 @@ export class PreviewComponent implements OnInit, OnDestroy {
 
   private animate() {
     this.animationTimer = requestAnimationFrame(() => this.animate());
+    // follows the geometry picked in the options
+    this.markerView.mesh.geometry = this.three.mesh.geometry;
+    this.drawMarker(performance.now());
     this.three.controls.update();
     this.three.renderer.render(this.three.scene, this.three.camera);
   }
@@ -1,13 +1,21 @@
 import { Injectable } from '@angular/core';
 import { Observable, interval, merge, race } from 'rxjs';
-import { switchMap, retryWhen, delay, scan, shareReplay, debounceTime, tap, ignoreElements, filter, timeout, map, refCount, publish } from 'rxjs/operators';
+import { switchMap, retryWhen, delay, scan, shareReplay, debounceTime, tap, ignoreElements, filter, timeout, map, refCount, publish, distinctUntilChanged } from 'rxjs/operators';
 import { PresentationService } from './presentation.service';
+import { PrintQueue } from './api.service';
+
+// binary frames of a streamed print, the printer gives credit for 8 KB at most
+const STREAM_CHUNK_SIZE = 1024;
+// binary frames from the printer start with their type, numbers are little endian
+const FRAME_PROGRESS = 1;
+const FRAME_POSITION = 2;
 
 @Injectable()
 export class WebSocketService {
     private readonly ws$ = race(new Observable<WebSocket>(observer => {
         const uri = `ws://${location.host}/api/ws`;
         const ws = new WebSocket(uri);
+        ws.binaryType = 'arraybuffer';
         ws.onopen = () => observer.next(ws);
         ws.onclose = () => observer.complete();
         ws.onerror = err => observer.error(err);
@@ -31,6 +39,9 @@ export class WebSocketService {
             return merge(msgs$, ping$, pong$).pipe(
                 filter(m => m !== '__pong__'),
                 map(msg => {
+                    if (msg instanceof ArrayBuffer) {
+                        return decodeFrame(msg);
+                    }
                     try {
                         const parsed: WsMessage = JSON.parse(msg);
                         return parsed;
@@ -53,29 +64,147 @@ export class WebSocketService {
             return ctx;
         }, {
             progress: 0,
+            percent: 0,
+            eta: 0,
             status: 'stopped',
             fileName: null,
             waitingFor: '',
+            confirmStart: false,
+            feedOverride: 100,
+            streaming: false,
+            queue: null,
+            position: null,
         } as {
             progress: number;
+            percent: number;
+            eta: number;
             fileName: string;
             waitingFor: string;
+            confirmStart: boolean;
+            feedOverride: number;
+            streaming: boolean;
+            queue: PrintQueue;
+            position: HeadPosition;
             status: 'paused' | 'printing' | 'stopped';
         }),
         debounceTime(0),
         shareReplay(1),
     );
 
+    readonly queue$ = this.status$.pipe(
+        map(s => s.queue),
+        filter(q => q != null),
+        distinctUntilChanged(),
+    );
+
+    // the job last started with streamPrint, there is no file to preview it from
+    streamedJob: { name: string, code: string } = null;
+
     constructor(
         private presentationService: PresentationService,
     ) {
     }
+
+    /**
+     * Prints the code without saving it, sent as the printer asks for it on a
+     * socket of its own. Emits the part sent so far (0 to 1); unsubscribing
+     * before it completes stops the print.
+     */
+    streamPrint(name: string, code: string) {
+        return new Observable<number>(observer => {
+            const data = new TextEncoder().encode(code);
+            const ws = new WebSocket(`ws://${location.host}/api/ws`);
+            let sent = 0;
+            let credit = 0;
+            let ended = false;
+            const send = () => {
+                while (sent < data.length && credit > 0) {
+                    const chunk = data.subarray(sent, sent + Math.min(credit, STREAM_CHUNK_SIZE));
+                    ws.send(chunk);
+                    sent += chunk.length;
+                    credit -= chunk.length;
+                }
+                observer.next(sent / data.length);
+                if (sent === data.length && !ended) {
+                    ended = true;
+                    ws.send('stream-end');
+                    observer.complete();
+                }
+            };
+            ws.onopen = () => {
+                this.streamedJob = { name, code };
+                ws.send(`stream-begin ${name}`);
+            };
+            ws.onmessage = event => {
+                let msg: WsMessage;
+                try {
+                    msg = JSON.parse(event.data);
+                } catch (err) {
+                    return;
+                }
+                if (msg.stream?.error) {
+                    observer.error(new Error(`Print ${msg.stream.error}`));
+                } else if (msg.stream?.credit) {
+                    credit += msg.stream.credit;
+                    send();
+                }
+            };
+            ws.onerror = err => observer.error(err);
+            ws.onclose = () => observer.error(new Error('Connection lost'));
+            return () => {
+                ws.onclose = null;
+                ws.close();
+            };
+        });
+    }
+}
+
+function decodeFrame(frame: ArrayBuffer): WsMessage {
+    const view = new DataView(frame);
+    if (view.byteLength >= 10 && view.getUint8(0) === FRAME_PROGRESS) {
+        return {
+            progress: view.getUint32(1, true),
+            percent: view.getUint8(5),
+            eta: view.getUint32(6, true),
+        };
+    }
+    if (view.byteLength >= 9 && view.getUint8(0) === FRAME_POSITION) {
+        const degrees = 360 / view.getUint16(5, true);
+        return {
+            position: {
+                x: view.getUint16(1, true) * degrees,
+                y: view.getInt16(3, true) * degrees,
+                penHeight: view.getUint8(7) / 255,
+                moving: view.getUint8(8) === 1,
+            },
+        };
+    }
+    return null;
+}
+
+/** Where the pen is on the egg, sampled by the printer as it moves. */
+export interface HeadPosition {
+    // degrees, x within one turn
+    x: number;
+    y: number;
+    // 0 down to 1 up
+    penHeight: number;
+    moving: boolean;
 }
 
 type WsMessage = Partial<{
     status: 'stopped' | 'printing' | 'paused';
     fileName?: string;
     progress: number;
+    percent: number;
+    eta: number;
     waitingFor?: string;
-
+    confirmStart?: boolean;
+    feedOverride?: number;
+    streaming?: boolean;
+    queue?: PrintQueue;
+    position?: HeadPosition;
+    stream?: { credit?: number, error?: string };
+    optimized?: string;
+    ok?: boolean;
 }>;
@@ -0,0 +1,75 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// The part of the Arduino core the printer uses, for building it on a PC.
+// Time is virtual, see sim.h.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+#define IRAM_ATTR
+
+typedef unsigned long ulong;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+void delay(uint32_t ms);
+// busy waits take no time in the simulation
+inline void delayMicroseconds(uint32_t us) {}
+unsigned long millis();
+unsigned long micros();
+
+// the metrics' clock: a 1MHz cycle counter on virtual time
+class EspClass
+{
+public:
+    uint32_t getCycleCount() { return micros(); }
+    uint32_t getCpuFreqMHz() { return 1; }
+};
+extern EspClass ESP;
+
+// not in older C libraries
+inline size_t simStrlcpy(char *destination, const char *source, size_t size)
+{
+    size_t length = strlen(source);
+    if (size)
+    {
+        size_t copied = length < size - 1 ? length : size - 1;
+        memcpy(destination, source, copied);
+        destination[copied] = 0;
+    }
+    return length;
+}
+#define strlcpy simStrlcpy
+
+class String
+{
+public:
+    String() {}
+    String(const char *text) : value(text ? text : "") {}
+
+    const char *c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.length(); }
+    bool equals(const String &other) const { return value == other.value; }
+    String &operator+=(const String &other)
+    {
+        value += other.value;
+        return *this;
+    }
+
+private:
+    std::string value;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef SIM_FS_H
+#define SIM_FS_H
+
+#include <stdio.h>
+#include <memory>
+
+#include "Arduino.h"
+
+namespace fs
+{
+
+struct SimFile;
+
+// copies share the open file, like on the ESP32
+class File
+{
+public:
+    File() {}
+    File(std::shared_ptr<SimFile> file) : file(file) {}
+
+    size_t read(uint8_t *buffer, size_t length);
+    size_t write(const uint8_t *buffer, size_t length);
+    bool seek(uint32_t position);
+    size_t size() const;
+    const char *name() const;
+    void close();
+    operator bool() const;
+
+private:
+    std::shared_ptr<SimFile> file;
+};
+
+// the host file system, paths are used as they are
+class FS
+{
+public:
+    File open(const char *path, const char *mode = "r");
+    bool exists(const char *path);
+    bool remove(const char *path);
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+extern fs::FS HostFS;
+
+#endif
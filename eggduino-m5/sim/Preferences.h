@@ -0,0 +1,22 @@
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include <stddef.h>
+#include <string>
+
+// kept in memory for the lifetime of the process, shared by all instances
+class Preferences
+{
+public:
+    bool begin(const char *name, bool readOnly = false);
+    void end() {}
+
+    size_t getBytes(const char *key, void *value, size_t length);
+    size_t putBytes(const char *key, const void *value, size_t length);
+    bool remove(const char *key);
+
+private:
+    std::string name;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef SIM_DEVICES_H
+#define SIM_DEVICES_H
+
+// Stepper driver and servo that follow the printer's pin and LEDC writes;
+// hook them up with simOnDigitalWrite/simOnLedcWrite.
+
+#include "Arduino.h"
+#include "printer.h"
+#include "sim.h"
+
+class VirtualStepper
+{
+public:
+    VirtualStepper(uint8_t stepPin, uint8_t dirPin) : stepPin(stepPin), dirPin(dirPin) {}
+
+    // true if the write made a step
+    bool write(uint8_t pin, uint8_t value)
+    {
+        if (pin == dirPin)
+        {
+            forward = value == HIGH;
+        }
+        else if (pin == stepPin && value == HIGH)
+        {
+            uint64_t now = simMicros();
+            if (steps && now - lastStep < shortestInterval)
+            {
+                shortestInterval = now - lastStep;
+            }
+            lastStep = now;
+            position += forward ? 1 : -1;
+            steps++;
+            return true;
+        }
+        return false;
+    }
+
+    // highest step rate seen, steps/s
+    uint32_t peakRate() const { return shortestInterval ? 1000000 / shortestInterval : 0; }
+
+    int32_t position = 0;
+    uint64_t steps = 0;
+
+private:
+    uint8_t stepPin, dirPin;
+    bool forward = true;
+    uint64_t lastStep = 0;
+    uint64_t shortestInterval = UINT64_MAX;
+};
+
+class VirtualServo
+{
+public:
+    VirtualServo(uint8_t channel) : channel(channel) {}
+
+    // true if the write moved the servo
+    bool write(uint8_t channel, uint32_t duty)
+    {
+        if (channel != this->channel)
+        {
+            return false;
+        }
+        uint8_t moved = ((duty - SERVO_MIN) * 100 + (SERVO_MAX - SERVO_MIN) / 2) / (SERVO_MAX - SERVO_MIN);
+        if (moved == percent && written)
+        {
+            return false;
+        }
+        if (!written)
+        {
+            // from wherever it was, not a direction
+            written = true;
+            percent = moved;
+            moves++;
+            return true;
+        }
+        // a ramp is many writes, a move is a ramp in one direction
+        int8_t direction = moved > percent ? 1 : -1;
+        if (direction != this->direction)
+        {
+            this->direction = direction;
+            moves++;
+        }
+        percent = moved;
+        return true;
+    }
+
+    uint8_t percent = 0;
+    uint32_t moves = 0;
+
+private:
+    uint8_t channel;
+    int8_t direction = 0;
+    bool written = false;
+};
+
+#endif
@@ -0,0 +1,314 @@
+// Runs reference jobs (bench/*.egg) through the job readers and the real
+// Printer on simulated hardware and reports, per job: parse throughput,
+// simulated print time, pen lifts, drawing and travel distance (steps, from
+// the job's moves) and the highest step rate the step interrupt produced.
+// --json writes the same as one JSON document, to compare across releases.
+//
+// g++ -std=c++11 -O2 -pthread -Isim -Isrc -Itools sim/sim.cpp sim/eggbench.cpp src/blockreader.cpp src/command.cpp src/eggbin.cpp src/estimator.cpp src/gzipsource.cpp src/jobreader.cpp src/jsonwriter.cpp src/pathfilter.cpp src/planner.cpp src/printer.cpp src/stepgen.cpp src/streambuffer.cpp src/strokespeed.cpp -o eggbench
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "devices.h"
+#include "hostjob.h"
+#include "jsonwriter.h"
+#include "printer.h"
+#include "sim.h"
+#include "wrap.h"
+
+#define BENCH_FORMAT 2
+// parsing repeats until it took at least this long
+#define BENCH_PARSE_MS 200
+
+struct JobResult
+{
+    const char *path;
+    uint32_t bytes;
+    uint32_t lines;
+    uint32_t linesPerSecond;
+    uint32_t printMs;
+    uint32_t estimatedSeconds;
+    uint32_t penLifts;
+    uint32_t pauses;
+    uint64_t drawSteps;
+    uint64_t travelSteps;
+    uint32_t peakRate[2];
+};
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: eggbench [options] job...\n"
+            "  --steps N      steps per rotation (6400)\n"
+            "  --draw N       drawing speed, steps/s (500)\n"
+            "  --travel N     travel speed, steps/s (2000)\n"
+            "  --accel N      acceleration, steps/s^2 (4000)\n"
+            "  --junction N   cornering deviation, steps (2)\n"
+            "  --start N      start speed, steps/s (2000)\n"
+            "  --pen-delay N  pen lift and lowering time, ms (150)\n"
+            "  --overlap N    motion during pen moves, ms (40)\n"
+            "  --json         write the results as JSON\n");
+    exit(1);
+}
+
+// one pass over the job like the print task makes, without moving anything;
+// distances are the machine's, which takes the shorter way round for travel
+static uint32_t scan(const char *path, const MotionParameters &params, JobResult &result)
+{
+    JobFile job;
+    if (!job.open(path, params.stepsPerRotation))
+    {
+        return 0;
+    }
+    result.bytes = job.size();
+
+    uint32_t lines = 0;
+    int32_t x = 0, y = 0;
+    bool penUp = true;
+    RotationWrap wrap;
+    wrap.begin(params.stepsPerRotation);
+    double draw = 0, travel = 0;
+    auto moveTo = [&](int32_t toX, int32_t toY, bool shortest) {
+        toX = wrap.map(toX, x, shortest);
+        (penUp ? travel : draw) += hypot(toX - x, toY - y);
+        x = toX;
+        y = toY;
+    };
+
+    Command cmd;
+    while (job.next(cmd))
+    {
+        lines++;
+        switch (cmd.type)
+        {
+        case CMD_MOVE:
+            moveTo(cmd.x, cmd.y, penUp || params.wrapDrawing);
+            break;
+        case CMD_PEN_UP:
+            result.penLifts += !penUp;
+            penUp = true;
+            break;
+        case CMD_PEN_DOWN:
+            penUp = false;
+            break;
+        case CMD_WAIT:
+        {
+            result.pauses++;
+            int32_t pen = y;
+            moveTo(wrap.unmap(x), 0, false);
+            moveTo(wrap.unmap(x), pen, false);
+            break;
+        }
+        case CMD_HOME:
+            moveTo(0, 0, true);
+            x = 0;
+            wrap.reset();
+            break;
+        default:
+            break;
+        }
+    }
+    result.drawSteps = draw + .5;
+    result.travelSteps = travel + .5;
+    return lines;
+}
+
+static uint32_t parseThroughput(const char *path, uint16_t stepsPerRotation)
+{
+    JobFile job;
+    if (!job.open(path, stepsPerRotation))
+    {
+        return 0;
+    }
+
+    // the file is read into memory, this measures the readers alone
+    auto start = std::chrono::steady_clock::now();
+    uint64_t lines = 0;
+    double seconds;
+    do
+    {
+        job.open(path, stepsPerRotation);
+        Command cmd;
+        while (job.next(cmd))
+        {
+            lines++;
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < BENCH_PARSE_MS / 1000.0);
+    return lines / seconds;
+}
+
+static bool run(Printer &printer, const char *path, JobResult &result)
+{
+    File file = HostFS.open(path);
+    if (!file)
+    {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+
+    VirtualStepper rotation(PIN_ROT_STEP, PIN_ROT_DIR), pen(PIN_PEN_STEP, PIN_PEN_DIR);
+    simOnDigitalWrite([&](uint8_t pin, uint8_t value) {
+        rotation.write(pin, value);
+        pen.write(pin, value);
+    });
+
+    uint64_t start = simMicros();
+    printer.print(file);
+    while (printer.isPrinting())
+    {
+        // S lines wait for a button press, continue right away
+        if (printer.isPaused())
+        {
+            printer.continuePrint();
+        }
+        if (printer.getEstimatedSeconds())
+        {
+            result.estimatedSeconds = printer.getEstimatedSeconds();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    simWaitForTasks();
+    simOnDigitalWrite(nullptr);
+
+    result.printMs = (simMicros() - start) / 1000;
+    result.peakRate[0] = rotation.peakRate();
+    result.peakRate[1] = pen.peakRate();
+    return true;
+}
+
+static const char *baseName(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static void writeJson(const MotionParameters &params, const std::vector<JobResult> &results)
+{
+    std::vector<char> buffer(512 + results.size() * 512);
+    JsonWriter json(buffer.data(), buffer.size());
+    json.beginObject()
+        .member("format", BENCH_FORMAT)
+        .key("parameters")
+        .beginObject()
+        .member("stepsPerRotation", params.stepsPerRotation)
+        .member("drawingSpeed", params.drawingSpeed)
+        .member("travelSpeed", params.travelSpeed)
+        .member("acceleration", params.acceleration)
+        .member("junctionDeviation", params.junctionDeviation)
+        .member("startSpeed", params.startSpeed)
+        .member("penUpDelay", params.penUpDelay)
+        .member("penDownDelay", params.penDownDelay)
+        .member("penOverlap", params.penOverlap)
+        .endObject()
+        .key("jobs")
+        .beginArray();
+    for (const JobResult &result : results)
+    {
+        json.beginObject()
+            .member("name", baseName(result.path))
+            .member("bytes", result.bytes)
+            .member("lines", result.lines)
+            .member("parseLinesPerSecond", result.linesPerSecond)
+            .member("printMs", result.printMs)
+            .member("estimatedSeconds", result.estimatedSeconds)
+            .member("penLifts", result.penLifts)
+            .member("pauses", result.pauses)
+            .member("drawSteps", (unsigned long)result.drawSteps)
+            .member("travelSteps", (unsigned long)result.travelSteps)
+            .key("peakStepRate")
+            .beginObject()
+            .member("rotation", result.peakRate[0])
+            .member("pen", result.peakRate[1])
+            .endObject()
+            .endObject();
+    }
+    json.endArray().endObject();
+    printf("%s\n", json.c_str());
+}
+
+static void writeTable(const std::vector<JobResult> &results)
+{
+    printf("%-16s %7s %10s %9s %7s %6s %6s %10s %10s %6s %6s\n", "job", "lines", "lines/s", "print s",
+           "est s", "lifts", "pauses", "draw", "travel", "rot/s", "pen/s");
+    for (const JobResult &result : results)
+    {
+        printf("%-16s %7u %10u %9.1f %7u %6u %6u %10llu %10llu %6u %6u\n", baseName(result.path),
+               result.lines, result.linesPerSecond, result.printMs / 1000.0, result.estimatedSeconds,
+               result.penLifts, result.pauses, (unsigned long long)result.drawSteps,
+               (unsigned long long)result.travelSteps, result.peakRate[0], result.peakRate[1]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    MotionParameters params;
+    getDefaultParameters(params);
+    bool json = false;
+    std::vector<const char *> paths;
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--steps") && hasValue)
+            params.stepsPerRotation = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--draw") && hasValue)
+            params.drawingSpeed = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--travel") && hasValue)
+            params.travelSpeed = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--accel") && hasValue)
+            params.acceleration = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--junction") && hasValue)
+            params.junctionDeviation = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--start") && hasValue)
+            params.startSpeed = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--pen-delay") && hasValue)
+            params.penUpDelay = params.penDownDelay = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--overlap") && hasValue)
+            params.penOverlap = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--json"))
+            json = true;
+        else if (argv[i][0] != '-')
+            paths.push_back(argv[i]);
+        else
+            usage();
+    }
+    if (paths.empty())
+    {
+        usage();
+    }
+
+    Printer printer;
+    printer.begin();
+    printer.setParameters(params);
+
+    std::vector<JobResult> results;
+    int status = 0;
+    for (const char *path : paths)
+    {
+        JobResult result = {};
+        result.path = path;
+        if (!(result.lines = scan(path, params, result)) ||
+            !run(printer, path, result))
+        {
+            status = 1;
+            continue;
+        }
+        result.linesPerSecond = parseThroughput(path, params.stepsPerRotation);
+        results.push_back(result);
+    }
+
+    if (json)
+    {
+        writeJson(params, results);
+    }
+    else
+    {
+        writeTable(results);
+    }
+    return status;
+}
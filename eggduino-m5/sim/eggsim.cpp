@@ -0,0 +1,164 @@
+// Prints a job with the real Printer on simulated hardware (sim.h) and
+// reports how long the printer takes. With --trace, every step and servo
+// change is written as "time_us,rotation,pen,servo" (positions in steps,
+// servo in percent).
+//
+// g++ -std=c++11 -O2 -pthread -Isim -Isrc sim/sim.cpp sim/eggsim.cpp src/blockreader.cpp src/command.cpp src/eggbin.cpp src/estimator.cpp src/gzipsource.cpp src/jobreader.cpp src/pathfilter.cpp src/planner.cpp src/printer.cpp src/stepgen.cpp src/streambuffer.cpp src/strokespeed.cpp -o eggsim
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#include "devices.h"
+#include "printer.h"
+#include "sim.h"
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: eggsim [options] job\n"
+            "  --steps N      steps per rotation (6400)\n"
+            "  --draw N       drawing speed, steps/s (500)\n"
+            "  --max-draw N   drawing speed of straight strokes, steps/s (1000)\n"
+            "  --run N        straight stroke length for it, steps (400)\n"
+            "  --travel N     travel speed, steps/s (2000)\n"
+            "  --accel N      acceleration, steps/s^2 (4000)\n"
+            "  --junction N   cornering deviation, steps (2)\n"
+            "  --start N      start speed, steps/s (2000)\n"
+            "  --pen-delay N  pen lift and lowering time, ms (150)\n"
+            "  --overlap N    motion during pen moves, ms (40)\n"
+            "  --feed N       feed rate override, percent (100)\n"
+            "  --from N       skip the first N lines, like resuming\n"
+            "  --trace FILE   write every step and servo move\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    MotionParameters params;
+    getDefaultParameters(params);
+    const char *path = nullptr, *tracePath = nullptr;
+    uint32_t fromLine = 0, feed = 100;
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--steps") && hasValue)
+            params.stepsPerRotation = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--draw") && hasValue)
+            params.drawingSpeed = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--max-draw") && hasValue)
+            params.maxDrawingSpeed = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--run") && hasValue)
+            params.straightRun = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--travel") && hasValue)
+            params.travelSpeed = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--accel") && hasValue)
+            params.acceleration = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--junction") && hasValue)
+            params.junctionDeviation = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--start") && hasValue)
+            params.startSpeed = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--pen-delay") && hasValue)
+            params.penUpDelay = params.penDownDelay = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--overlap") && hasValue)
+            params.penOverlap = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--feed") && hasValue)
+            feed = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--from") && hasValue)
+            fromLine = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--trace") && hasValue)
+            tracePath = argv[++i];
+        else if (argv[i][0] != '-' && !path)
+            path = argv[i];
+        else
+            usage();
+    }
+    if (!path)
+    {
+        usage();
+    }
+
+    File file = HostFS.open(path);
+    if (!file)
+    {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+    FILE *trace = NULL;
+    if (tracePath && !(trace = fopen(tracePath, "w")))
+    {
+        fprintf(stderr, "cannot write %s\n", tracePath);
+        return 1;
+    }
+
+    VirtualStepper rotation(PIN_ROT_STEP, PIN_ROT_DIR), pen(PIN_PEN_STEP, PIN_PEN_DIR);
+    VirtualServo servo(SERVO_CHA);
+    auto record = [&]() {
+        if (trace)
+        {
+            fprintf(trace, "%llu,%d,%d,%u\n", (unsigned long long)simMicros(),
+                    rotation.position, pen.position, servo.percent);
+        }
+    };
+    simOnDigitalWrite([&](uint8_t pin, uint8_t value) {
+        bool stepped = rotation.write(pin, value);
+        stepped = pen.write(pin, value) || stepped;
+        if (stepped)
+        {
+            record();
+        }
+    });
+    simOnLedcWrite([&](uint8_t channel, uint32_t duty) {
+        if (servo.write(channel, duty))
+        {
+            record();
+        }
+    });
+
+    Printer printer;
+    printer.begin();
+    printer.setParameters(params);
+    printer.setFeedOverride(feed);
+
+    auto wallStart = std::chrono::steady_clock::now();
+    uint64_t start = simMicros();
+    uint32_t estimated = 0, pauses = 0;
+    printer.print(file, fromLine);
+    while (printer.isPrinting())
+    {
+        // S lines wait for a button press, continue right away
+        if (printer.isPaused())
+        {
+            pauses++;
+            printer.continuePrint();
+        }
+        if (printer.getEstimatedSeconds())
+        {
+            estimated = printer.getEstimatedSeconds();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    simWaitForTasks();
+    double seconds = (simMicros() - start) / 1e6;
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    if (trace)
+    {
+        fclose(trace);
+    }
+
+    printf("%s\n", path);
+    printf("print time   %10.1f s  (estimated %u s)\n", seconds, estimated);
+    printf("rotation     %10llu steps  ends at %d\n", (unsigned long long)rotation.steps, rotation.position);
+    printf("pen          %10llu steps  ends at %d\n", (unsigned long long)pen.steps, pen.position);
+    printf("servo moves  %10u\n", servo.moves);
+    printf("pauses       %10u\n", pauses);
+    // in virtual time, so only the waits
+    const PrintMetrics &metrics = printer.getMetrics();
+    printf("motion waits %10u  %.1f s\n", metrics.motionWait.count, metrics.motionWait.total / 1e6);
+    printf("pen waits    %10u  %.1f s\n", metrics.penWait.count, metrics.penWait.total / 1e6);
+    printf("simulated in %10.2f s\n", wall);
+    return 0;
+}
@@ -0,0 +1,10 @@
+#ifndef SIM_ESP32_HAL_LEDC_H
+#define SIM_ESP32_HAL_LEDC_H
+
+#include <stdint.h>
+
+double ledcSetup(uint8_t channel, double frequency, uint8_t resolution);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcWrite(uint8_t channel, uint32_t duty);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef SIM_ESP32_HAL_TIMER_H
+#define SIM_ESP32_HAL_TIMER_H
+
+#include <stdint.h>
+
+// the simulated timer counts microseconds of virtual time, whatever the divider
+struct hw_timer_t;
+
+hw_timer_t *timerBegin(uint8_t number, uint16_t divider, bool countUp);
+void timerAttachInterrupt(hw_timer_t *timer, void (*handler)(), bool edge);
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarm, bool autoReload);
+void timerAlarmEnable(hw_timer_t *timer);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef SIM_FREERTOS_TASK_H
+#define SIM_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+// Tasks are threads. Only tasks above SIM_BACKGROUND_PRIORITY (and the main
+// thread) spend virtual time when they wait; background tasks (the job
+// reader, the pen ramp) just yield, like they would to a higher priority
+// task.
+#define SIM_BACKGROUND_PRIORITY 1
+
+struct SimTask;
+typedef SimTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth,
+                                   void *parameters, UBaseType_t priority, TaskHandle_t *created, BaseType_t core);
+// only a task can delete itself
+void vTaskDelete(TaskHandle_t task);
+// only a task can suspend itself
+void vTaskSuspend(TaskHandle_t task);
+void vTaskResume(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+// only portMAX_DELAY; a task waiting here counts as done for simWaitForTasks
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+// threads have no stack of a set size to measure
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) { return 0; }
+
+#endif
@@ -0,0 +1,396 @@
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "Arduino.h"
+#include "FS.h"
+#include "Preferences.h"
+#include "esp32-hal-ledc.h"
+#include "esp32-hal-timer.h"
+#include "sim.h"
+
+// clock and step timer
+
+struct hw_timer_t
+{
+    void (*handler)();
+    uint64_t alarm;
+    uint64_t next;
+    bool enabled;
+};
+
+static std::mutex clockMutex;
+static std::atomic<uint64_t> now(0);
+static hw_timer_t timer = {NULL, 0, 0, false};
+
+// moves virtual time forward, firing the timer interrupt on the way
+static void advance(uint64_t micros)
+{
+    std::lock_guard<std::mutex> lock(clockMutex);
+    uint64_t until = now + micros;
+    while (timer.enabled && timer.handler && timer.next <= until)
+    {
+        now = timer.next;
+        timer.handler();
+        timer.next = now + (timer.alarm ? timer.alarm : 1);
+    }
+    now = until;
+}
+
+uint64_t simMicros()
+{
+    return now;
+}
+
+hw_timer_t *timerBegin(uint8_t number, uint16_t divider, bool countUp)
+{
+    return &timer;
+}
+
+void timerAttachInterrupt(hw_timer_t *timer, void (*handler)(), bool edge)
+{
+    timer->handler = handler;
+}
+
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarm, bool autoReload)
+{
+    timer->alarm = alarm;
+}
+
+void timerAlarmEnable(hw_timer_t *timer)
+{
+    timer->next = now + timer->alarm;
+    timer->enabled = true;
+}
+
+// tasks
+
+struct SimTask
+{
+    bool background;
+    std::mutex mutex;
+    std::condition_variable resumed;
+    bool resume = false;
+    uint32_t notifications = 0;
+};
+
+struct SimTaskDeleted
+{
+};
+
+static thread_local SimTask *currentTask = NULL;
+static std::mutex tasksMutex;
+static std::condition_variable tasksDone;
+static int runningTasks = 0;
+// waiting for a notification with nothing to do
+static int idleTasks = 0;
+
+static void wait(uint64_t micros)
+{
+    if (!currentTask || !currentTask->background)
+    {
+        advance(micros);
+    }
+    std::this_thread::yield();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth,
+                                   void *parameters, UBaseType_t priority, TaskHandle_t *created, BaseType_t core)
+{
+    // handles stay valid after the task ends, they are compared afterwards
+    SimTask *task = new SimTask();
+    task->background = priority <= SIM_BACKGROUND_PRIORITY;
+    if (created)
+    {
+        *created = task;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        runningTasks++;
+    }
+    std::thread([task, function, parameters]() {
+        currentTask = task;
+        try
+        {
+            function(parameters);
+        }
+        catch (const SimTaskDeleted &)
+        {
+        }
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        runningTasks--;
+        tasksDone.notify_all();
+    }).detach();
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (!task || task == currentTask)
+    {
+        // unwinds the thread back to xTaskCreatePinnedToCore
+        throw SimTaskDeleted();
+    }
+    fprintf(stderr, "sim: a task can only delete itself\n");
+    abort();
+}
+
+void vTaskSuspend(TaskHandle_t task)
+{
+    if (!task || task != currentTask)
+    {
+        fprintf(stderr, "sim: a task can only suspend itself\n");
+        abort();
+    }
+    std::unique_lock<std::mutex> lock(task->mutex);
+    task->resumed.wait(lock, [task]() { return task->resume; });
+    task->resume = false;
+}
+
+void vTaskResume(TaskHandle_t task)
+{
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->resume = true;
+    task->resumed.notify_all();
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    wait(ticks * portTICK_PERIOD_MS * 1000ULL);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    SimTask *task = currentTask;
+    std::unique_lock<std::mutex> lock(task->mutex);
+    if (!task->notifications)
+    {
+        {
+            std::lock_guard<std::mutex> tasksLock(tasksMutex);
+            idleTasks++;
+            tasksDone.notify_all();
+        }
+        task->resumed.wait(lock, [task]() { return task->notifications > 0; });
+        std::lock_guard<std::mutex> tasksLock(tasksMutex);
+        idleTasks--;
+    }
+    uint32_t taken = task->notifications;
+    task->notifications = clear ? 0 : taken - 1;
+    return taken;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->notifications++;
+    task->resumed.notify_all();
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return currentTask;
+}
+
+void simWaitForTasks()
+{
+    std::unique_lock<std::mutex> lock(tasksMutex);
+    tasksDone.wait(lock, []() { return runningTasks == idleTasks; });
+}
+
+// pins, servo and time
+
+static std::function<void(uint8_t, uint8_t)> digitalWriteHandler;
+static std::function<void(uint8_t, uint32_t)> ledcWriteHandler;
+
+void simOnDigitalWrite(std::function<void(uint8_t pin, uint8_t value)> handler)
+{
+    digitalWriteHandler = handler;
+}
+
+void simOnLedcWrite(std::function<void(uint8_t channel, uint32_t duty)> handler)
+{
+    ledcWriteHandler = handler;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (digitalWriteHandler)
+    {
+        digitalWriteHandler(pin, value);
+    }
+}
+
+double ledcSetup(uint8_t channel, double frequency, uint8_t resolution)
+{
+    return frequency;
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t channel)
+{
+}
+
+void ledcWrite(uint8_t channel, uint32_t duty)
+{
+    if (ledcWriteHandler)
+    {
+        ledcWriteHandler(channel, duty);
+    }
+}
+
+void delay(uint32_t ms)
+{
+    wait(ms * 1000ULL);
+}
+
+unsigned long millis()
+{
+    return now / 1000;
+}
+
+unsigned long micros()
+{
+    return now;
+}
+
+EspClass ESP;
+
+// preferences
+
+static std::mutex preferencesMutex;
+static std::map<std::string, std::string> preferences;
+
+bool Preferences::begin(const char *name, bool readOnly)
+{
+    this->name = name;
+    return true;
+}
+
+size_t Preferences::getBytes(const char *key, void *value, size_t length)
+{
+    std::lock_guard<std::mutex> lock(preferencesMutex);
+    auto stored = preferences.find(name + "/" + key);
+    if (stored == preferences.end() || stored->second.size() > length)
+    {
+        return 0;
+    }
+    memcpy(value, stored->second.data(), stored->second.size());
+    return stored->second.size();
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t length)
+{
+    std::lock_guard<std::mutex> lock(preferencesMutex);
+    preferences[name + "/" + key] = std::string((const char *)value, length);
+    return length;
+}
+
+bool Preferences::remove(const char *key)
+{
+    std::lock_guard<std::mutex> lock(preferencesMutex);
+    return preferences.erase(name + "/" + key) > 0;
+}
+
+// files
+
+namespace fs
+{
+
+struct SimFile
+{
+    SimFile(FILE *handle, const char *path) : handle(handle), path(path) {}
+    ~SimFile()
+    {
+        if (handle)
+        {
+            fclose(handle);
+        }
+    }
+
+    FILE *handle;
+    std::string path;
+};
+
+size_t File::read(uint8_t *buffer, size_t length)
+{
+    return *this ? fread(buffer, 1, length, file->handle) : 0;
+}
+
+size_t File::write(const uint8_t *buffer, size_t length)
+{
+    return *this ? fwrite(buffer, 1, length, file->handle) : 0;
+}
+
+bool File::seek(uint32_t position)
+{
+    return *this && !fseek(file->handle, position, SEEK_SET);
+}
+
+size_t File::size() const
+{
+    if (!*this)
+    {
+        return 0;
+    }
+    long position = ftell(file->handle);
+    fseek(file->handle, 0, SEEK_END);
+    long size = ftell(file->handle);
+    fseek(file->handle, position, SEEK_SET);
+    return size;
+}
+
+const char *File::name() const
+{
+    return file ? file->path.c_str() : "";
+}
+
+void File::close()
+{
+    if (*this)
+    {
+        fclose(file->handle);
+        file->handle = NULL;
+    }
+}
+
+File::operator bool() const
+{
+    return file && file->handle;
+}
+
+File FS::open(const char *path, const char *mode)
+{
+    FILE *handle = fopen(path, mode[0] == 'w' ? "wb" : mode[0] == 'a' ? "ab" : "rb");
+    if (!handle)
+    {
+        return File();
+    }
+    return File(std::make_shared<SimFile>(handle, path));
+}
+
+bool FS::exists(const char *path)
+{
+    FILE *handle = fopen(path, "rb");
+    if (handle)
+    {
+        fclose(handle);
+    }
+    return handle != NULL;
+}
+
+bool FS::remove(const char *path)
+{
+    return ::remove(path) == 0;
+}
+
+} // namespace fs
+
+fs::FS HostFS;
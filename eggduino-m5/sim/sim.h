@@ -0,0 +1,25 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <functional>
+
+// Controls the simulated hardware the printer runs on.
+//
+// Time is virtual: it only moves when a task (or the main thread) waits in
+// delay/vTaskDelay, and while it moves the step timer interrupt fires at
+// the times it asked for. A job therefore runs as fast as the host can
+// compute it, and its virtual duration is what the printer would take.
+
+// virtual time since start, in microseconds
+uint64_t simMicros();
+
+// called on every pin write and servo (LEDC) write, from the writing thread
+void simOnDigitalWrite(std::function<void(uint8_t pin, uint8_t value)> handler);
+void simOnLedcWrite(std::function<void(uint8_t channel, uint32_t duty)> handler);
+
+// waits (in real time) until every task has deleted itself or waits for a
+// notification
+void simWaitForTasks();
+
+#endif
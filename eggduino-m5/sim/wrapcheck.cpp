@@ -0,0 +1,254 @@
+// Checks that taking the shorter way round the egg keeps the job where it
+// belongs: generates a long job with travel across the seam, far-off
+// absolute rotations, H and S lines, prints it with the real Printer on
+// simulated hardware and verifies at every pen change that the machine is
+// at the job's position (modulo whole turns for the rotation), that no
+// travel move goes more than half a turn, and that H ends at home. Then
+// resumes a short job right after an H, which must start from home.
+//
+// g++ -std=c++11 -O2 -pthread -Isim -Isrc sim/sim.cpp sim/wrapcheck.cpp src/blockreader.cpp src/command.cpp src/eggbin.cpp src/estimator.cpp src/gzipsource.cpp src/jobreader.cpp src/pathfilter.cpp src/planner.cpp src/printer.cpp src/stepgen.cpp src/streambuffer.cpp src/strokespeed.cpp -o wrapcheck
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "devices.h"
+#include "printer.h"
+#include "sim.h"
+
+// where the job has the pen when it goes down or up, and how many travel
+// moves lead there
+struct PenChange
+{
+    int32_t position[2];
+    uint32_t travelMoves;
+};
+
+static uint32_t seed = 1;
+
+static int32_t random(int32_t from, int32_t to)
+{
+    seed = seed * 1103515245 + 12345;
+    return from + (int32_t)((seed >> 8) % (uint32_t)(to - from + 1));
+}
+
+// moves are written in hundredths of a degree, like the web client does
+static void writeMove(FILE *job, int32_t x, int32_t y, uint16_t stepsPerRotation, int32_t *position)
+{
+    char line[COMMAND_MAX_LENGTH + 1];
+    snprintf(line, sizeof(line), "T %.2f %.2f", x / 100.0, y / 100.0);
+    fprintf(job, "%s\n", line);
+    Command cmd;
+    parseCommand(line, stepsPerRotation, cmd);
+    position[0] = cmd.x;
+    position[1] = cmd.y;
+}
+
+static void generate(FILE *job, uint32_t segments, uint16_t stepsPerRotation, std::vector<PenChange> &changes)
+{
+    int32_t position[2] = {0, 0};
+    uint32_t travelMoves = 0;
+    fprintf(job, "M1\nP0\nH\n");
+    for (uint32_t i = 0; i < segments; i++)
+    {
+        if (i % 500 == 499)
+        {
+            fprintf(job, "H\n");
+            position[0] = position[1] = 0;
+            travelMoves++;
+        }
+        if (i % 2000 == 1999)
+        {
+            fprintf(job, "S layer %u\n", i / 2000);
+        }
+
+        // anywhere within three turns either way, often right across the seam
+        int32_t x = random(0, 3) ? random(-1000, 1000) + 36000 * random(-3, 3) : random(-108000, 108000);
+        int32_t y = random(-3000, 3000);
+        writeMove(job, x, y, stepsPerRotation, position);
+        travelMoves++;
+        fprintf(job, "P1\n");
+        changes.push_back({{position[0], position[1]}, travelMoves});
+        travelMoves = 0;
+
+        for (int32_t move = random(1, 6); move > 0; move--)
+        {
+            x += random(-500, 500);
+            y = std::min(3000, std::max(-3000, y + random(-300, 300)));
+            writeMove(job, x, y, stepsPerRotation, position);
+        }
+        fprintf(job, "P0\n");
+        changes.push_back({{position[0], position[1]}, 0});
+    }
+    fprintf(job, "H\nM0\n");
+}
+
+// the job after its fourth line (H) is at home with the pen up, the rest
+// draws one stroke without turning the egg
+static uint32_t checkResumeAfterHome(Printer &printer, const MotionParameters &params)
+{
+    const char *path = "wrapcheck-home.egg";
+    const char *lines[] = {"M1", "P0", "T 90 10", "H", "P1", "T 0 5", "P0"};
+    FILE *job = fopen(path, "w");
+    if (!job)
+    {
+        perror(path);
+        return 1;
+    }
+    JobEstimator estimator(params);
+    for (uint8_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++)
+    {
+        fprintf(job, "%s\n", lines[i]);
+        Command cmd;
+        parseCommand(lines[i], params.stepsPerRotation, cmd);
+        if (i < 4)
+        {
+            estimator.add(cmd);
+        }
+    }
+    fclose(job);
+
+    uint32_t failures = 0;
+    if (estimator.getPosition(0) || estimator.getPosition(1) || !estimator.isPenUp())
+    {
+        fprintf(stderr, "estimate after H at %d,%d, not at home\n", estimator.getPosition(0), estimator.getPosition(1));
+        failures++;
+    }
+
+    VirtualStepper rotation(PIN_ROT_STEP, PIN_ROT_DIR), pen(PIN_PEN_STEP, PIN_PEN_DIR);
+    simOnDigitalWrite([&](uint8_t pin, uint8_t value) {
+        rotation.write(pin, value);
+        pen.write(pin, value);
+    });
+    simOnLedcWrite([](uint8_t, uint32_t) {});
+    printer.print(HostFS.open(path), 4);
+    while (printer.isPrinting())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    simWaitForTasks();
+    remove(path);
+
+    int32_t penEnd = degreesToSteps(5, params.stepsPerRotation);
+    if (rotation.steps || pen.position != penEnd)
+    {
+        fprintf(stderr, "resumed after H: rotation moved %llu steps, pen ended at %d not %d\n",
+                (unsigned long long)rotation.steps, pen.position, penEnd);
+        failures++;
+    }
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    MotionParameters params;
+    getDefaultParameters(params);
+    // the pen only moves where the job has it change
+    params.penOverlap = 0;
+    uint32_t segments = 3000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--segments") && i + 1 < argc)
+            segments = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+            seed = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: wrapcheck [--segments N] [--seed N]\n");
+            return 1;
+        }
+    }
+
+    const char *path = "wrapcheck.egg";
+    FILE *job = fopen(path, "w");
+    if (!job)
+    {
+        perror(path);
+        return 1;
+    }
+    std::vector<PenChange> changes;
+    generate(job, segments, params.stepsPerRotation, changes);
+    fclose(job);
+
+    int32_t turn = params.stepsPerRotation;
+    VirtualStepper rotation(PIN_ROT_STEP, PIN_ROT_DIR), pen(PIN_PEN_STEP, PIN_PEN_DIR);
+    VirtualServo servo(SERVO_CHA);
+    size_t checked = 0;
+    // setting the printer up moves the servo too
+    bool started = false;
+    uint32_t failures = 0;
+    uint64_t travelFrom = 0;
+    int32_t farthest = 0;
+    auto fail = [&](const char *what, const PenChange &change) {
+        if (failures++ < 10)
+        {
+            fprintf(stderr, "pen change %zu: %s (job %d,%d, machine %d,%d)\n", checked, what,
+                    change.position[0], change.position[1], rotation.position, pen.position);
+        }
+    };
+    simOnDigitalWrite([&](uint8_t pin, uint8_t value) {
+        rotation.write(pin, value);
+        pen.write(pin, value);
+        farthest = std::max(farthest, abs(rotation.position));
+    });
+    simOnLedcWrite([&](uint8_t channel, uint32_t duty) {
+        // where each pen move starts
+        uint32_t moves = servo.moves;
+        if (!servo.write(channel, duty) || servo.moves == moves || !started || checked >= changes.size())
+        {
+            return;
+        }
+        const PenChange &change = changes[checked];
+        if (((rotation.position - change.position[0]) % turn + turn) % turn)
+        {
+            fail("rotation is off", change);
+        }
+        if (pen.position != change.position[1])
+        {
+            fail("pen is off", change);
+        }
+        if (change.travelMoves && rotation.steps - travelFrom > change.travelMoves * (uint64_t)turn / 2)
+        {
+            fail("travel went the long way", change);
+        }
+        travelFrom = rotation.steps;
+        checked++;
+    });
+
+    Printer printer;
+    printer.begin();
+    printer.setParameters(params);
+    // until the pen is up
+    simWaitForTasks();
+    started = true;
+    printer.print(HostFS.open(path));
+    while (printer.isPrinting())
+    {
+        if (printer.isPaused())
+        {
+            printer.continuePrint();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    simWaitForTasks();
+    remove(path);
+
+    if (checked != changes.size())
+    {
+        fprintf(stderr, "saw %zu of %zu pen changes\n", checked, changes.size());
+        failures++;
+    }
+    if (rotation.position % turn || pen.position)
+    {
+        fprintf(stderr, "H ended at %d,%d, not at home\n", rotation.position, pen.position);
+        failures++;
+    }
+    failures += checkResumeAfterHome(printer, params);
+
+    printf("%u segments, %zu pen changes checked, at most %.1f turns from the start, %u failures\n",
+           segments, checked, farthest / (double)turn, failures);
+    return failures ? 1 : 0;
+}
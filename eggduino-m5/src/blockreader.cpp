@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <string.h>
+#include "blockreader.h"
+
+BlockReader::BlockReader(ByteSource &source, WaitHandler wait)
+    : source(source),
+      wait(wait),
+      aborted(false),
+      stalls(0),
+      current(0),
+      offset(0)
+{
+    for (auto &block : blocks)
+    {
+        block.data = NULL;
+        block.length = 0;
+        block.full = false;
+    }
+}
+
+BlockReader::~BlockReader()
+{
+    for (auto &block : blocks)
+    {
+        free(block.data);
+    }
+}
+
+bool BlockReader::begin()
+{
+    for (auto &block : blocks)
+    {
+        block.data = (uint8_t *)malloc(BLOCK_READER_BLOCK_SIZE);
+        if (!block.data)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BlockReader::fill()
+{
+    uint8_t next = 0;
+    while (!aborted.load(std::memory_order_acquire))
+    {
+        Block &block = blocks[next];
+        if (block.full.load(std::memory_order_acquire))
+        {
+            wait();
+            continue;
+        }
+
+        size_t length = 0, read;
+        while (length < BLOCK_READER_BLOCK_SIZE &&
+               (read = source.read(block.data + length, BLOCK_READER_BLOCK_SIZE - length)) > 0)
+        {
+            length += read;
+        }
+
+        // an empty block marks the end
+        block.length.store(length, std::memory_order_relaxed);
+        block.full.store(true, std::memory_order_release);
+        if (!length)
+        {
+            return;
+        }
+        next ^= 1;
+    }
+}
+
+size_t BlockReader::read(uint8_t *buffer, size_t length)
+{
+    size_t total = 0;
+    while (total < length)
+    {
+        Block &block = blocks[current.load(std::memory_order_relaxed)];
+        if (!block.full.load(std::memory_order_acquire))
+        {
+            if (aborted.load(std::memory_order_acquire))
+            {
+                break;
+            }
+            stalls.store(stalls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            do
+            {
+                wait();
+            } while (!block.full.load(std::memory_order_acquire) && !aborted.load(std::memory_order_acquire));
+            continue;
+        }
+
+        uint16_t blockLength = block.length.load(std::memory_order_relaxed);
+        if (!blockLength)
+        {
+            // end of the source, the block stays full
+            break;
+        }
+
+        uint16_t position = offset.load(std::memory_order_relaxed);
+        size_t chunk = blockLength - position;
+        if (chunk > length - total)
+        {
+            chunk = length - total;
+        }
+        memcpy(buffer + total, block.data + position, chunk);
+        total += chunk;
+        position += chunk;
+
+        if (position == blockLength)
+        {
+            offset.store(0, std::memory_order_relaxed);
+            block.full.store(false, std::memory_order_release);
+            current.store(current.load(std::memory_order_relaxed) ^ 1, std::memory_order_relaxed);
+        }
+        else
+        {
+            offset.store(position, std::memory_order_relaxed);
+        }
+    }
+    return total;
+}
+
+size_t BlockReader::getReadAhead() const
+{
+    // a snapshot from another task, may be off by one block change
+    size_t ahead = 0;
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        const Block &block = blocks[i];
+        if (block.full.load(std::memory_order_acquire))
+        {
+            ahead += block.length.load(std::memory_order_relaxed);
+        }
+    }
+    size_t consumed = offset.load(std::memory_order_relaxed);
+    return ahead > consumed ? ahead - consumed : 0;
+}
@@ -0,0 +1,57 @@
+#ifndef BLOCKREADER_H
+#define BLOCKREADER_H
+
+#include <atomic>
+
+#include "bytestream.h"
+
+#define BLOCK_READER_BLOCK_SIZE 4096
+
+// Reads a source in large blocks into two alternating buffers. fill() runs
+// on its own (low priority) task and keeps both buffers full, read() hands
+// out the buffered bytes and only waits if the filler fell behind.
+class BlockReader : public ByteSource
+{
+public:
+    typedef void (*WaitHandler)();
+
+    // wait is called while either side has to wait for the other
+    BlockReader(ByteSource &source, WaitHandler wait);
+    ~BlockReader();
+
+    bool begin();
+
+    // filler side: reads the whole source; returns once it reached the end
+    // or abort() was called
+    void fill();
+    void abort() { aborted.store(true, std::memory_order_release); }
+
+    // consumer side
+    size_t read(uint8_t *buffer, size_t length) override;
+
+    // bytes buffered ahead of the consumer
+    size_t getReadAhead() const;
+    // times the consumer had to wait for the filler
+    uint32_t getStalls() const { return stalls.load(std::memory_order_relaxed); }
+
+private:
+    struct Block
+    {
+        uint8_t *data;
+        std::atomic<uint16_t> length;
+        // set by the filler, cleared by the consumer
+        std::atomic<bool> full;
+    };
+
+    ByteSource &source;
+    WaitHandler wait;
+    Block blocks[2];
+    std::atomic<bool> aborted;
+    std::atomic<uint32_t> stalls;
+
+    // consumer position, atomic only so getReadAhead can peek at it
+    std::atomic<uint8_t> current;
+    std::atomic<uint16_t> offset;
+};
+
+#endif
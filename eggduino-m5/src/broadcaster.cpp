@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "broadcaster.h"
+
+Broadcaster::Broadcaster(BroadcastSink &sink, uint8_t maxRate)
+    : sink(sink), maxRate(maxRate)
+{
+    memset(slots, 0, sizeof(slots));
+    memset(clients, 0, sizeof(clients));
+    memset(&counters, 0, sizeof(counters));
+}
+
+Broadcaster::~Broadcaster()
+{
+    for (uint8_t i = 0; i < BROADCAST_SLOTS; i++)
+    {
+        free(slots[i].data);
+    }
+}
+
+bool Broadcaster::addClient(uint32_t id)
+{
+    Client *entry = NULL;
+    for (uint8_t i = 0; i < BROADCAST_CLIENTS && !entry; i++)
+    {
+        // entries of clients gone without anything due since are reused
+        if (!clients[i].id || sink.getState(clients[i].id) == SINK_GONE)
+        {
+            entry = &clients[i];
+        }
+    }
+    if (!entry)
+    {
+        return false;
+    }
+
+    memset(entry, 0, sizeof(Client));
+    entry->id = id;
+    return true;
+}
+
+bool Broadcaster::publish(uint8_t slot, const uint8_t *data, size_t length, bool binary)
+{
+    Slot &s = slots[slot];
+    if (length > s.capacity)
+    {
+        uint8_t *grown = (uint8_t *)realloc(s.data, length);
+        if (!grown)
+        {
+            return false;
+        }
+        s.data = grown;
+        s.capacity = length;
+    }
+
+    for (uint8_t i = 0; i < BROADCAST_CLIENTS; i++)
+    {
+        if (clients[i].id && s.version && clients[i].versions[slot] != s.version)
+        {
+            counters.coalesced++;
+        }
+    }
+    memcpy(s.data, data, length);
+    s.length = length;
+    s.binary = binary;
+    s.version++;
+    return true;
+}
+
+bool Broadcaster::isDue(const Client &client) const
+{
+    for (uint8_t i = 0; i < BROADCAST_SLOTS; i++)
+    {
+        if (slots[i].version != client.versions[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Broadcaster::sendDue(Client &client, uint32_t now)
+{
+    for (uint8_t i = 0; i < BROADCAST_SLOTS; i++)
+    {
+        const Slot &slot = slots[i];
+        if (slot.version == client.versions[i])
+        {
+            continue;
+        }
+
+        SinkState state = sink.getState(client.id);
+        if (state == SINK_GONE)
+        {
+            return false;
+        }
+        if (state == SINK_FULL)
+        {
+            // the rest waits for the next turn, by then maybe replaced
+            for (; i < BROADCAST_SLOTS; i++)
+            {
+                counters.dropped += slots[i].version != client.versions[i] ? 1 : 0;
+            }
+            if (!client.full)
+            {
+                client.full = true;
+                client.fullSince = now;
+            }
+            else if (now - client.fullSince >= BROADCAST_STALL_TIMEOUT)
+            {
+                sink.close(client.id);
+                counters.closed++;
+                return false;
+            }
+            return true;
+        }
+
+        sink.send(client.id, slot.data, slot.length, slot.binary);
+        client.versions[i] = slot.version;
+        client.full = false;
+        counters.sent++;
+    }
+    return true;
+}
+
+void Broadcaster::flush(uint32_t now)
+{
+    uint8_t rate = getMaxRate();
+    uint32_t interval = rate ? 1000 / rate : 0;
+    for (uint8_t i = 0; i < BROADCAST_CLIENTS; i++)
+    {
+        Client &client = clients[i];
+        // a new client gets its first messages straight away
+        bool waited = !client.lastSent || now - client.lastSent >= interval;
+        if (!client.id || !waited || !isDue(client))
+        {
+            continue;
+        }
+
+        client.lastSent = now ? now : 1;
+        if (!sendDue(client, now))
+        {
+            client.id = 0;
+        }
+    }
+}
+
+uint8_t Broadcaster::getClientCount() const
+{
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < BROADCAST_CLIENTS; i++)
+    {
+        count += clients[i].id ? 1 : 0;
+    }
+    return count;
+}
@@ -0,0 +1,103 @@
+#ifndef BROADCASTER_H
+#define BROADCASTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// kinds of message, each client is sent the latest of every one
+#define BROADCAST_SLOTS 5
+// AsyncWebSocket's default DEFAULT_MAX_WS_CLIENTS
+#define BROADCAST_CLIENTS 8
+// a client whose queue stays full this long is closed, ms
+#define BROADCAST_STALL_TIMEOUT 10000
+
+enum SinkState : uint8_t
+{
+    SINK_GONE,
+    SINK_FULL,
+    SINK_READY,
+};
+
+// Where the frames go, the websocket in the firmware.
+class BroadcastSink
+{
+public:
+    virtual ~BroadcastSink() {}
+    virtual SinkState getState(uint32_t client) = 0;
+    virtual void send(uint32_t client, const uint8_t *data, size_t length, bool binary) = 0;
+    virtual void close(uint32_t client) = 0;
+};
+
+struct BroadcastCounters
+{
+    // frames handed to the sink
+    uint32_t sent;
+    // messages replaced before a client was sent them, once per client
+    uint32_t coalesced;
+    // frames held back because a client's queue was full
+    uint32_t dropped;
+    // clients closed for staying full
+    uint32_t closed;
+};
+
+// Sends state to many clients no faster than each can take it. A message
+// is published once into its slot, replacing the one before; every client
+// is sent the latest message of each slot it has not had, at most maxRate
+// times a second, so a slow client gets fewer updates rather than a
+// backlog. Not thread safe: publish and flush from one task.
+class Broadcaster
+{
+public:
+    // 0 for no limit
+    Broadcaster(BroadcastSink &sink, uint8_t maxRate);
+    ~Broadcaster();
+
+    // any task
+    void setMaxRate(uint8_t perSecond) { maxRate.store(perSecond, std::memory_order_relaxed); }
+    uint8_t getMaxRate() const { return maxRate.load(std::memory_order_relaxed); }
+
+    // the client is sent every slot on the next flush; false if there are
+    // too many
+    bool addClient(uint32_t client);
+    // false if the message could not be stored, the slot keeps the last one
+    bool publish(uint8_t slot, const uint8_t *data, size_t length, bool binary);
+    // sends whatever is due, call often
+    void flush(uint32_t now);
+
+    uint8_t getClientCount() const;
+    const BroadcastCounters &getCounters() const { return counters; }
+
+private:
+    struct Slot
+    {
+        uint8_t *data;
+        size_t length, capacity;
+        bool binary;
+        // 0 until there is a message
+        uint32_t version;
+    };
+    struct Client
+    {
+        // 0 for a free entry
+        uint32_t id;
+        uint32_t lastSent;
+        // the queue was full from then on
+        bool full;
+        uint32_t fullSince;
+        // the version of each slot it was last sent
+        uint32_t versions[BROADCAST_SLOTS];
+    };
+
+    bool isDue(const Client &client) const;
+    // false once the client is gone or closed
+    bool sendDue(Client &client, uint32_t now);
+
+    BroadcastSink &sink;
+    std::atomic<uint8_t> maxRate;
+    Slot slots[BROADCAST_SLOTS];
+    Client clients[BROADCAST_CLIENTS];
+    BroadcastCounters counters;
+};
+
+#endif
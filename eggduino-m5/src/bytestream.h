@@ -0,0 +1,30 @@
+#ifndef BYTESTREAM_H
+#define BYTESTREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class ByteSource
+{
+public:
+    virtual ~ByteSource() {}
+    // returns the number of bytes read, 0 at the end
+    virtual size_t read(uint8_t *buffer, size_t length) = 0;
+};
+
+// a source that can also jump to a byte offset
+class SeekableSource : public ByteSource
+{
+public:
+    virtual bool seek(uint32_t offset) = 0;
+};
+
+class ByteSink
+{
+public:
+    virtual ~ByteSink() {}
+    // returns the number of bytes written
+    virtual size_t write(const uint8_t *buffer, size_t length) = 0;
+};
+
+#endif
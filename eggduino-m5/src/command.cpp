@@ -0,0 +1,59 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "command.h"
+
+int32_t degreesToSteps(float degrees, uint16_t stepsPerRotation)
+{
+    return roundf(degrees / 360.0f * stepsPerRotation);
+}
+
+bool parseCommand(const char *line, uint16_t stepsPerRotation, Command &cmd)
+{
+    cmd.type = CMD_NONE;
+
+    if (strcmp(line, "P0") == 0)
+    {
+        cmd.type = CMD_PEN_UP;
+    }
+    else if (strcmp(line, "P1") == 0)
+    {
+        cmd.type = CMD_PEN_DOWN;
+    }
+    else if (strcmp(line, "M1") == 0)
+    {
+        cmd.type = CMD_MOTORS_ENABLE;
+    }
+    else if (strcmp(line, "M0") == 0)
+    {
+        cmd.type = CMD_MOTORS_DISABLE;
+    }
+    else if (strcmp(line, "H") == 0)
+    {
+        cmd.type = CMD_HOME;
+    }
+    else if (line[0] == 'Z')
+    {
+        cmd.type = CMD_PROGRESS;
+        cmd.value = line[1] ? atoi(&line[2]) : 0;
+    }
+    else if (line[0] == 'S')
+    {
+        cmd.type = CMD_WAIT;
+        strncpy(cmd.text, line[1] ? &line[2] : "", COMMAND_MAX_LENGTH);
+        cmd.text[COMMAND_MAX_LENGTH] = 0;
+    }
+    else if (line[0] == 'T' && line[1])
+    {
+        const char *y = strchr(&line[2], ' ');
+        if (!y)
+        {
+            return false;
+        }
+        cmd.type = CMD_MOVE;
+        cmd.x = degreesToSteps(atof(&line[2]), stepsPerRotation);
+        cmd.y = degreesToSteps(atof(y), stepsPerRotation);
+    }
+
+    return cmd.type != CMD_NONE;
+}
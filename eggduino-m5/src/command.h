@@ -0,0 +1,35 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stdint.h>
+
+#define COMMAND_MAX_LENGTH 30
+
+enum CommandType : uint8_t
+{
+    CMD_NONE,
+    CMD_PEN_UP,
+    CMD_PEN_DOWN,
+    CMD_MOTORS_ENABLE,
+    CMD_MOTORS_DISABLE,
+    CMD_PROGRESS,
+    CMD_WAIT,
+    CMD_HOME,
+    CMD_MOVE,
+};
+
+struct Command
+{
+    CommandType type;
+    int32_t x, y;
+    int32_t value;
+    char text[COMMAND_MAX_LENGTH + 1];
+};
+
+int32_t degreesToSteps(float degrees, uint16_t stepsPerRotation);
+
+// parses one line of an .egg job (without the trailing new line);
+// returns false if the line is empty or not a known command
+bool parseCommand(const char *line, uint16_t stepsPerRotation, Command &cmd);
+
+#endif
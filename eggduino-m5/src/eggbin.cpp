@@ -0,0 +1,284 @@
+#include <string.h>
+#include "eggbin.h"
+
+static void putInt16(uint8_t *buffer, int16_t value)
+{
+    buffer[0] = value;
+    buffer[1] = (uint16_t)value >> 8;
+}
+
+static void putInt32(uint8_t *buffer, int32_t value)
+{
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        buffer[i] = (uint32_t)value >> (8 * i);
+    }
+}
+
+static int16_t getInt16(const uint8_t *buffer)
+{
+    return (int16_t)(buffer[0] | buffer[1] << 8);
+}
+
+static int32_t getInt32(const uint8_t *buffer)
+{
+    return (int32_t)((uint32_t)buffer[0] | (uint32_t)buffer[1] << 8 |
+                     (uint32_t)buffer[2] << 16 | (uint32_t)buffer[3] << 24);
+}
+
+bool isEggBinaryHeader(const uint8_t *header, size_t length)
+{
+    return length >= EGGBIN_HEADER_SIZE &&
+           memcmp(header, EGGBIN_MAGIC, 4) == 0 &&
+           header[4] == EGGBIN_VERSION;
+}
+
+uint16_t getEggBinaryStepsPerRotation(const uint8_t *header)
+{
+    return getInt16(&header[6]);
+}
+
+EggBinaryEncoder::EggBinaryEncoder(ByteSink &sink, uint16_t stepsPerRotation)
+    : sink(sink),
+      stepsPerRotation(stepsPerRotation),
+      position{0, 0}
+{
+}
+
+bool EggBinaryEncoder::begin()
+{
+    uint8_t header[EGGBIN_HEADER_SIZE];
+    memcpy(header, EGGBIN_MAGIC, 4);
+    header[4] = EGGBIN_VERSION;
+    header[5] = 0;
+    putInt16(&header[6], stepsPerRotation);
+    return sink.write(header, sizeof(header)) == sizeof(header);
+}
+
+bool EggBinaryEncoder::write(const Command &cmd)
+{
+    uint8_t record[2 + COMMAND_MAX_LENGTH];
+    size_t length = 1;
+
+    switch (cmd.type)
+    {
+    case CMD_PEN_UP:
+        record[0] = EGGBIN_OP_PEN_UP;
+        break;
+    case CMD_PEN_DOWN:
+        record[0] = EGGBIN_OP_PEN_DOWN;
+        break;
+    case CMD_MOTORS_ENABLE:
+        record[0] = EGGBIN_OP_MOTORS_ENABLE;
+        break;
+    case CMD_MOTORS_DISABLE:
+        record[0] = EGGBIN_OP_MOTORS_DISABLE;
+        break;
+    case CMD_HOME:
+        record[0] = EGGBIN_OP_HOME;
+        break;
+    case CMD_PROGRESS:
+        record[0] = EGGBIN_OP_PROGRESS;
+        record[1] = cmd.value < 0 ? 0 : cmd.value > 255 ? 255 : cmd.value;
+        length = 2;
+        break;
+    case CMD_WAIT:
+        record[0] = EGGBIN_OP_WAIT;
+        record[1] = strlen(cmd.text);
+        memcpy(&record[2], cmd.text, record[1]);
+        length = 2 + record[1];
+        break;
+    case CMD_MOVE:
+    {
+        int32_t dx = cmd.x - position[0], dy = cmd.y - position[1];
+        if (dx >= INT16_MIN && dx <= INT16_MAX && dy >= INT16_MIN && dy <= INT16_MAX)
+        {
+            record[0] = EGGBIN_OP_MOVE;
+            putInt16(&record[1], dx);
+            putInt16(&record[3], dy);
+            length = 5;
+        }
+        else
+        {
+            record[0] = EGGBIN_OP_MOVE_ABSOLUTE;
+            putInt32(&record[1], cmd.x);
+            putInt32(&record[5], cmd.y);
+            length = 9;
+        }
+        position[0] = cmd.x;
+        position[1] = cmd.y;
+        break;
+    }
+    default:
+        record[0] = EGGBIN_OP_NONE;
+        break;
+    }
+
+    return sink.write(record, length) == length;
+}
+
+BinaryJobReader::BinaryJobReader(ByteSource &source, uint16_t stepsPerRotation)
+    : source(source),
+      stepsPerRotation(stepsPerRotation),
+      jobStepsPerRotation(stepsPerRotation),
+      position{0, 0},
+      bufferPosition(0),
+      bufferLength(0),
+      offset(0)
+{
+}
+
+bool BinaryJobReader::readBytes(uint8_t *value, size_t count)
+{
+    while (count)
+    {
+        if (bufferPosition == bufferLength)
+        {
+            bufferPosition = 0;
+            bufferLength = source.read(buffer, sizeof(buffer));
+            if (!bufferLength)
+            {
+                return false;
+            }
+        }
+        size_t chunk = bufferLength - bufferPosition;
+        if (chunk > count)
+        {
+            chunk = count;
+        }
+        memcpy(value, &buffer[bufferPosition], chunk);
+        bufferPosition += chunk;
+        offset += chunk;
+        value += chunk;
+        count -= chunk;
+    }
+    return true;
+}
+
+bool BinaryJobReader::begin()
+{
+    uint8_t header[EGGBIN_HEADER_SIZE];
+    if (!readBytes(header, sizeof(header)) || !isEggBinaryHeader(header, sizeof(header)))
+    {
+        return false;
+    }
+    jobStepsPerRotation = getEggBinaryStepsPerRotation(header);
+    return jobStepsPerRotation != 0;
+}
+
+void BinaryJobReader::mark(JobMark &mark) const
+{
+    mark.offset = offset;
+    mark.position[0] = position[0];
+    mark.position[1] = position[1];
+    mark.stepsPerRotation = jobStepsPerRotation;
+}
+
+void BinaryJobReader::restore(const JobMark &mark)
+{
+    bufferPosition = bufferLength = 0;
+    offset = mark.offset;
+    position[0] = mark.position[0];
+    position[1] = mark.position[1];
+    jobStepsPerRotation = mark.stepsPerRotation;
+}
+
+int32_t BinaryJobReader::scale(int32_t steps) const
+{
+    if (jobStepsPerRotation == stepsPerRotation)
+    {
+        return steps;
+    }
+    int64_t scaled = (int64_t)steps * stepsPerRotation;
+    return (scaled + (scaled < 0 ? -jobStepsPerRotation : jobStepsPerRotation) / 2) / jobStepsPerRotation;
+}
+
+bool BinaryJobReader::next(Command &cmd)
+{
+    uint8_t record[COMMAND_MAX_LENGTH + 1];
+    if (!readBytes(record, 1))
+    {
+        return false;
+    }
+
+    cmd.type = CMD_NONE;
+    switch (record[0])
+    {
+    case EGGBIN_OP_NONE:
+        break;
+    case EGGBIN_OP_PEN_UP:
+        cmd.type = CMD_PEN_UP;
+        break;
+    case EGGBIN_OP_PEN_DOWN:
+        cmd.type = CMD_PEN_DOWN;
+        break;
+    case EGGBIN_OP_MOTORS_ENABLE:
+        cmd.type = CMD_MOTORS_ENABLE;
+        break;
+    case EGGBIN_OP_MOTORS_DISABLE:
+        cmd.type = CMD_MOTORS_DISABLE;
+        break;
+    case EGGBIN_OP_HOME:
+        cmd.type = CMD_HOME;
+        break;
+    case EGGBIN_OP_PROGRESS:
+        if (!readBytes(record, 1))
+        {
+            return false;
+        }
+        cmd.type = CMD_PROGRESS;
+        cmd.value = record[0];
+        break;
+    case EGGBIN_OP_WAIT:
+    {
+        if (!readBytes(record, 1))
+        {
+            return false;
+        }
+        uint8_t stored = record[0];
+        uint8_t length = stored > COMMAND_MAX_LENGTH ? COMMAND_MAX_LENGTH : stored;
+        if (!readBytes((uint8_t *)cmd.text, length))
+        {
+            return false;
+        }
+        // skip whatever does not fit (never written by the encoder)
+        for (uint8_t skip = stored - length; skip; skip--)
+        {
+            if (!readBytes(record, 1))
+            {
+                return false;
+            }
+        }
+        cmd.text[length] = 0;
+        cmd.type = CMD_WAIT;
+        break;
+    }
+    case EGGBIN_OP_MOVE:
+        if (!readBytes(record, 4))
+        {
+            return false;
+        }
+        position[0] += getInt16(&record[0]);
+        position[1] += getInt16(&record[2]);
+        cmd.type = CMD_MOVE;
+        cmd.x = scale(position[0]);
+        cmd.y = scale(position[1]);
+        break;
+    case EGGBIN_OP_MOVE_ABSOLUTE:
+        if (!readBytes(record, 8))
+        {
+            return false;
+        }
+        position[0] = getInt32(&record[0]);
+        position[1] = getInt32(&record[4]);
+        cmd.type = CMD_MOVE;
+        cmd.x = scale(position[0]);
+        cmd.y = scale(position[1]);
+        break;
+    default:
+        // corrupt, or from a newer encoder: the length of what follows is
+        // unknown, so nothing after it can be trusted
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef EGGBIN_H
+#define EGGBIN_H
+
+#include "bytestream.h"
+#include "jobreader.h"
+
+// Binary job format: an 8 byte header followed by one record per line of
+// the original text job, so line numbers stay the same. Moves are stored
+// as step deltas from the previous move.
+//
+// header: "EGGB", version, reserved, stepsPerRotation (uint16)
+// records: opcode byte + fixed size operands, multi byte values little endian
+
+#define EGGBIN_MAGIC "EGGB"
+#define EGGBIN_VERSION 1
+#define EGGBIN_HEADER_SIZE 8
+
+#define EGGBIN_OP_NONE 0x00
+#define EGGBIN_OP_PEN_UP 0x01
+#define EGGBIN_OP_PEN_DOWN 0x02
+#define EGGBIN_OP_MOTORS_ENABLE 0x03
+#define EGGBIN_OP_MOTORS_DISABLE 0x04
+#define EGGBIN_OP_HOME 0x05
+// uint8 percent
+#define EGGBIN_OP_PROGRESS 0x06
+// uint8 length + text
+#define EGGBIN_OP_WAIT 0x07
+// int16 dx, int16 dy
+#define EGGBIN_OP_MOVE 0x08
+// int32 x, int32 y
+#define EGGBIN_OP_MOVE_ABSOLUTE 0x09
+
+bool isEggBinaryHeader(const uint8_t *header, size_t length);
+uint16_t getEggBinaryStepsPerRotation(const uint8_t *header);
+
+class EggBinaryEncoder
+{
+public:
+    EggBinaryEncoder(ByteSink &sink, uint16_t stepsPerRotation);
+
+    bool begin();
+    // encodes one line of the job
+    bool write(const Command &cmd);
+
+private:
+    ByteSink &sink;
+    uint16_t stepsPerRotation;
+    int32_t position[2];
+};
+
+class BinaryJobReader : public JobReader
+{
+public:
+    // moves are rescaled if the job was encoded for a different stepsPerRotation
+    BinaryJobReader(ByteSource &source, uint16_t stepsPerRotation);
+
+    // reads and checks the header
+    bool begin();
+    // also false at an opcode it does not know, the job ends there
+    bool next(Command &cmd) override;
+    void mark(JobMark &mark) const override;
+    // replaces begin(), the mark carries what the header holds
+    void restore(const JobMark &mark) override;
+
+private:
+    bool readBytes(uint8_t *value, size_t count);
+    int32_t scale(int32_t steps) const;
+
+    ByteSource &source;
+    uint16_t stepsPerRotation, jobStepsPerRotation;
+    int32_t position[2];
+    uint8_t buffer[64];
+    size_t bufferPosition, bufferLength;
+    uint32_t offset;
+};
+
+#endif
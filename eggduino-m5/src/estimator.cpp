@@ -0,0 +1,120 @@
+#include "estimator.h"
+
+JobEstimator::JobEstimator(const MotionParameters &params)
+    : params(params),
+      seconds(0),
+      lines(0),
+      position{0, 0},
+      penUp(true)
+{
+    planner.setAcceleration(params.acceleration);
+    planner.setJunctionDeviation(params.junctionDeviation);
+    planner.setStartSpeed(params.startSpeed);
+    wrap.begin(params.stepsPerRotation);
+    filter.begin(params.pathTolerance, 0, 0);
+    strokes.begin(params.drawingSpeed, params.maxDrawingSpeed, params.straightRun, 0, 0);
+}
+
+void JobEstimator::add(const Command &cmd)
+{
+    lines++;
+    switch (cmd.type)
+    {
+    case CMD_MOVE:
+        filter.add(cmd.x, cmd.y);
+        runFilteredMoves();
+        position[0] = cmd.x;
+        position[1] = cmd.y;
+        break;
+    case CMD_PEN_UP:
+    case CMD_PEN_DOWN:
+        finishMoves();
+        if (penUp != (cmd.type == CMD_PEN_UP))
+        {
+            penUp = !penUp;
+            seconds += penMoveTime(params, penUp) / 1000.0f;
+        }
+        break;
+    case CMD_WAIT:
+    {
+        int32_t pen = position[1];
+        finishMoves();
+        moveTo(position[0], 0, false);
+        moveTo(position[0], pen, false);
+        finishMoves();
+        break;
+    }
+    case CMD_HOME:
+        finishMoves();
+        moveTo(0, 0, true);
+        finishMoves();
+        // like the printer, home is the job's rotation 0 again
+        position[0] = position[1] = 0;
+        planner.setPosition(0, 0);
+        wrap.reset();
+        filter.setPosition(0, 0);
+        strokes.setPosition(0, 0);
+        break;
+    case CMD_MOTORS_ENABLE:
+    case CMD_MOTORS_DISABLE:
+        finishMoves();
+        break;
+    default:
+        break;
+    }
+}
+
+float JobEstimator::end()
+{
+    finishMoves();
+    return seconds;
+}
+
+void JobEstimator::moveTo(int32_t x, int32_t y, bool shortest)
+{
+    moveTo(x, y, shortest, penUp ? params.travelSpeed : params.drawingSpeed);
+}
+
+void JobEstimator::moveTo(int32_t x, int32_t y, bool shortest, float speed)
+{
+    if (planner.isFull())
+    {
+        seconds += Planner::duration(*planner.current());
+        planner.discardCurrent();
+    }
+    int32_t rotation = wrap.map(x, planner.getPosition(0), shortest);
+    planner.push(rotation, y, speed);
+}
+
+void JobEstimator::runFilteredMoves()
+{
+    int32_t x, y;
+    while (filter.next(x, y))
+    {
+        strokes.add(x, y);
+        runStrokeMoves();
+    }
+}
+
+void JobEstimator::runStrokeMoves()
+{
+    int32_t x, y;
+    float speed;
+    while (strokes.next(x, y, speed))
+    {
+        moveTo(x, y, penUp || params.wrapDrawing, penUp ? params.travelSpeed : speed);
+    }
+}
+
+void JobEstimator::finishMoves()
+{
+    filter.flush();
+    runFilteredMoves();
+    strokes.flush();
+    runStrokeMoves();
+    while (!planner.isEmpty())
+    {
+        seconds += Planner::duration(*planner.current());
+        planner.discardCurrent();
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef ESTIMATOR_H
+#define ESTIMATOR_H
+
+#include "command.h"
+#include "motionparams.h"
+#include "pathfilter.h"
+#include "planner.h"
+#include "strokespeed.h"
+#include "wrap.h"
+
+// Predicts how long a job takes by running its commands through the path
+// filter, stroke speeds and planner the printer uses (pen moves cost what
+// penMoveTime says, S pauses nothing)
+class JobEstimator
+{
+public:
+    JobEstimator(const MotionParameters &params);
+
+    void add(const Command &cmd);
+    // finishes the queued moves and returns the total in seconds
+    float end();
+
+    float getSeconds() const { return seconds; }
+    unsigned long getLines() const { return lines; }
+    // where the commands added so far leave the job (not the machine, which
+    // may be whole turns away)
+    int32_t getPosition(uint8_t axis) const { return position[axis]; }
+    bool isPenUp() const { return penUp; }
+
+private:
+    // x, y in the job; shortest takes the shorter way round the egg
+    void moveTo(int32_t x, int32_t y, bool shortest);
+    void moveTo(int32_t x, int32_t y, bool shortest, float speed);
+    void runFilteredMoves();
+    void runStrokeMoves();
+    void finishMoves();
+
+    const MotionParameters &params;
+    PathFilter filter;
+    StrokeSpeed strokes;
+    Planner planner;
+    RotationWrap wrap;
+    float seconds;
+    unsigned long lines;
+    int32_t position[2];
+    bool penUp;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <atomic>
+
+#include "spsc.h"
+
+#define PRINTER_EVENT_QUEUE_SIZE 16
+
+enum PrinterEventType : uint8_t
+{
+    EVENT_PROGRESS,
+    EVENT_STATUS,
+};
+
+// a snapshot taken by the print task, formatted later by the web layer
+struct PrinterEvent
+{
+    PrinterEventType type;
+    uint8_t percent;
+    uint32_t lines;
+    uint32_t remainingSeconds;
+};
+
+// Hands printer events to a consumer on another task without locks or
+// allocation. Progress comes from the print task only (the queue producer);
+// status changes can come from any task and are kept as a flag, since the
+// consumer reads the current status anyway.
+class PrinterEvents
+{
+public:
+    PrinterEvents() : statusChanged(false), dropped(0) {}
+
+    // print task only; a full queue drops the event, the next progress
+    // supersedes it
+    void pushProgress(uint32_t lines, uint8_t percent, uint32_t remainingSeconds)
+    {
+        PrinterEvent event;
+        event.type = EVENT_PROGRESS;
+        event.percent = percent;
+        event.lines = lines;
+        event.remainingSeconds = remainingSeconds;
+        if (!queue.push(event))
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // any task
+    void pushStatus() { statusChanged.store(true, std::memory_order_release); }
+
+    // consumer only: status first, then the queued progress in order
+    bool pop(PrinterEvent &event)
+    {
+        if (statusChanged.exchange(false, std::memory_order_acq_rel))
+        {
+            event.type = EVENT_STATUS;
+            return true;
+        }
+        return queue.pop(event);
+    }
+
+    uint32_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    SpscQueue<PrinterEvent, PRINTER_EVENT_QUEUE_SIZE> queue;
+    std::atomic<bool> statusChanged;
+    std::atomic<uint32_t> dropped;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef FSSTREAM_H
+#define FSSTREAM_H
+
+#include <FS.h>
+
+#include "bytestream.h"
+
+class FileSource : public SeekableSource
+{
+public:
+    FileSource(File &file) : file(file) {}
+    size_t read(uint8_t *buffer, size_t length) override { return file.read(buffer, length); }
+    bool seek(uint32_t offset) override { return file.seek(offset); }
+
+private:
+    File &file;
+};
+
+// collects small writes (like binary job records) into larger SD writes
+class FileSink : public ByteSink
+{
+public:
+    FileSink(File &file) : file(file), length(0) {}
+    ~FileSink() { flush(); }
+
+    size_t write(const uint8_t *data, size_t size) override
+    {
+        if (length + size > sizeof(buffer) && !flush())
+        {
+            return 0;
+        }
+        if (size > sizeof(buffer))
+        {
+            return file.write(data, size);
+        }
+        memcpy(buffer + length, data, size);
+        length += size;
+        return size;
+    }
+
+    bool flush()
+    {
+        bool written = file.write(buffer, length) == length;
+        length = 0;
+        return written;
+    }
+
+private:
+    File &file;
+    uint8_t buffer[512];
+    size_t length;
+};
+
+#endif
@@ -0,0 +1,470 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "gzipsource.h"
+
+#define WINDOW_MASK (GZIP_WINDOW_SIZE - 1)
+
+static_assert((GZIP_WINDOW_SIZE & WINDOW_MASK) == 0, "GZIP_WINDOW_SIZE must be a power of two");
+
+#define GZIP_FLAG_HCRC 0x02
+#define GZIP_FLAG_EXTRA 0x04
+#define GZIP_FLAG_NAME 0x08
+#define GZIP_FLAG_COMMENT 0x10
+#define GZIP_FLAG_RESERVED 0xe0
+
+// length and distance symbols: the smallest value and the extra bits after
+static const uint16_t lengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t lengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distanceBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t distanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+// the order code lengths of the code length code are stored in
+static const uint8_t codeLengthOrder[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// crc32 a nibble at a time, a small table is enough at SD card speeds
+static const uint32_t crcTable[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c};
+
+static inline uint32_t crcByte(uint32_t crc, uint8_t value)
+{
+    crc ^= value;
+    crc = (crc >> 4) ^ crcTable[crc & 15];
+    return (crc >> 4) ^ crcTable[crc & 15];
+}
+
+bool isGzipHeader(const uint8_t *header, size_t length)
+{
+    // the magic and deflate, the only method there is
+    return length >= 3 && header[0] == 0x1f && header[1] == 0x8b && header[2] == 8;
+}
+
+GzipSource::GzipSource(ByteSource &source)
+    : source(source),
+      window(NULL),
+      input(NULL),
+      inputLength(0),
+      inputPosition(0),
+      truncated(false),
+      state(STATE_FAILED),
+      lastBlock(false),
+      bitBuffer(0),
+      bitCount(0),
+      storedLeft(0),
+      matchLength(0),
+      matchDistance(0),
+      output(0),
+      crc(0)
+{
+}
+
+GzipSource::~GzipSource()
+{
+    free(window);
+    free(input);
+}
+
+bool GzipSource::begin()
+{
+    state = STATE_FAILED;
+    if (!window)
+    {
+        window = (uint8_t *)malloc(GZIP_WINDOW_SIZE);
+        input = (uint8_t *)malloc(GZIP_INPUT_SIZE);
+        if (!window || !input)
+        {
+            return false;
+        }
+    }
+    inputLength = inputPosition = 0;
+    truncated = false;
+    lastBlock = false;
+    bitBuffer = bitCount = 0;
+    storedLeft = matchLength = matchDistance = 0;
+    output = 0;
+    crc = 0xffffffff;
+
+    // magic, method, flags, time, extra flags, os
+    uint8_t header[10];
+    for (auto &value : header)
+    {
+        value = nextByte();
+    }
+    if (truncated || !isGzipHeader(header, sizeof(header)) || (header[3] & GZIP_FLAG_RESERVED))
+    {
+        return false;
+    }
+
+    uint8_t flags = header[3];
+    if (flags & GZIP_FLAG_EXTRA)
+    {
+        uint16_t length = nextByte();
+        length |= nextByte() << 8;
+        while (length-- && !truncated)
+        {
+            nextByte();
+        }
+    }
+    if ((flags & GZIP_FLAG_NAME) && !skipHeaderString())
+    {
+        return false;
+    }
+    if ((flags & GZIP_FLAG_COMMENT) && !skipHeaderString())
+    {
+        return false;
+    }
+    if (flags & GZIP_FLAG_HCRC)
+    {
+        nextByte();
+        nextByte();
+    }
+    if (truncated)
+    {
+        return false;
+    }
+    state = STATE_BLOCK;
+    return true;
+}
+
+bool GzipSource::skipHeaderString()
+{
+    while (!truncated && nextByte() != 0)
+    {
+    }
+    return !truncated;
+}
+
+bool GzipSource::skip(uint32_t length)
+{
+    uint8_t buffer[256];
+    while (length)
+    {
+        size_t read = this->read(buffer, length < sizeof(buffer) ? length : sizeof(buffer));
+        if (!read)
+        {
+            return false;
+        }
+        length -= read;
+    }
+    return true;
+}
+
+int16_t GzipSource::nextByte()
+{
+    if (inputPosition == inputLength)
+    {
+        inputPosition = 0;
+        inputLength = source.read(input, GZIP_INPUT_SIZE);
+        if (!inputLength)
+        {
+            truncated = true;
+            return -1;
+        }
+    }
+    return input[inputPosition++];
+}
+
+uint32_t GzipSource::bits(uint8_t count)
+{
+    // deflate packs from the least significant bit up
+    while (bitCount < count)
+    {
+        int16_t value = nextByte();
+        if (value < 0)
+        {
+            return 0;
+        }
+        bitBuffer |= (uint32_t)value << bitCount;
+        bitCount += 8;
+    }
+    uint32_t value = bitBuffer & ((1ul << count) - 1);
+    bitBuffer >>= count;
+    bitCount -= count;
+    return value;
+}
+
+int16_t GzipSource::decode(const Huffman &code)
+{
+    // codes of each length follow the shorter ones, so walking the lengths
+    // one bit at a time finds the symbol without a lookup table
+    int32_t value = 0, first = 0, index = 0;
+    for (uint8_t length = 1; length < 16; length++)
+    {
+        value |= bits(1);
+        int32_t count = code.counts[length];
+        if (value - first < count)
+        {
+            return code.symbols[index + value - first];
+        }
+        index += count;
+        first = (first + count) << 1;
+        value <<= 1;
+    }
+    return -1;
+}
+
+bool GzipSource::build(Huffman &code, const uint8_t *lengths, uint16_t count)
+{
+    memset(code.counts, 0, sizeof(code.counts));
+    for (uint16_t symbol = 0; symbol < count; symbol++)
+    {
+        code.counts[lengths[symbol]]++;
+    }
+
+    // more codes than lengths allow is corrupt, fewer is allowed
+    int32_t left = 1;
+    for (uint8_t length = 1; length < 16; length++)
+    {
+        left = (left << 1) - code.counts[length];
+        if (left < 0)
+        {
+            return false;
+        }
+    }
+
+    uint16_t offsets[16];
+    offsets[1] = 0;
+    for (uint8_t length = 1; length < 15; length++)
+    {
+        offsets[length + 1] = offsets[length] + code.counts[length];
+    }
+    for (uint16_t symbol = 0; symbol < count; symbol++)
+    {
+        if (lengths[symbol])
+        {
+            code.symbols[offsets[lengths[symbol]]++] = symbol;
+        }
+    }
+    code.counts[0] = 0;
+    return true;
+}
+
+bool GzipSource::beginBlock()
+{
+    lastBlock = bits(1);
+    uint8_t type = bits(2);
+    if (type == 0)
+    {
+        // stored: from the next byte, its length and the length inverted
+        bitBuffer = bitCount = 0;
+        uint16_t length = bits(16);
+        uint16_t inverted = bits(16);
+        if ((uint16_t)~length != inverted)
+        {
+            return false;
+        }
+        storedLeft = length;
+        state = STATE_STORED;
+        return true;
+    }
+    if (type == 1)
+    {
+        uint8_t lengths[288 + 30];
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 112);
+        memset(lengths + 256, 7, 24);
+        memset(lengths + 280, 8, 8);
+        memset(lengths + 288, 5, 30);
+        build(lengthCode, lengths, 288);
+        build(distanceCode, lengths + 288, 30);
+        state = STATE_HUFFMAN;
+        return true;
+    }
+    if (type == 2 && readCodes())
+    {
+        state = STATE_HUFFMAN;
+        return true;
+    }
+    return false;
+}
+
+bool GzipSource::readCodes()
+{
+    uint16_t lengthCount = bits(5) + 257;
+    uint8_t distanceCount = bits(5) + 1;
+    uint8_t codeLengthCount = bits(4) + 4;
+    if (lengthCount > 286 || distanceCount > 30)
+    {
+        return false;
+    }
+
+    // the code lengths are themselves Huffman coded; lengthCode holds that
+    // code until the real one is built
+    uint8_t lengths[286 + 30];
+    memset(lengths, 0, 19);
+    for (uint8_t i = 0; i < codeLengthCount; i++)
+    {
+        lengths[codeLengthOrder[i]] = bits(3);
+    }
+    if (!build(lengthCode, lengths, 19))
+    {
+        return false;
+    }
+
+    uint16_t index = 0, total = lengthCount + distanceCount;
+    while (index < total)
+    {
+        int16_t symbol = decode(lengthCode);
+        if (symbol < 0 || truncated)
+        {
+            return false;
+        }
+        if (symbol < 16)
+        {
+            lengths[index++] = symbol;
+            continue;
+        }
+
+        // repeats: the previous length 3-6 times, zero 3-10 or 11-138 times
+        uint8_t length = 0;
+        uint8_t repeat;
+        if (symbol == 16)
+        {
+            if (!index)
+            {
+                return false;
+            }
+            length = lengths[index - 1];
+            repeat = 3 + bits(2);
+        }
+        else if (symbol == 17)
+        {
+            repeat = 3 + bits(3);
+        }
+        else
+        {
+            repeat = 11 + bits(7);
+        }
+        if (index + repeat > total)
+        {
+            return false;
+        }
+        memset(lengths + index, length, repeat);
+        index += repeat;
+    }
+
+    // without an end of block code the block never ends
+    return lengths[256] &&
+           build(lengthCode, lengths, lengthCount) &&
+           build(distanceCode, lengths + lengthCount, distanceCount);
+}
+
+bool GzipSource::readTrailer()
+{
+    bitBuffer = bitCount = 0;
+    uint32_t expectedCrc = bits(16);
+    expectedCrc |= bits(16) << 16;
+    uint32_t size = bits(16);
+    size |= bits(16) << 16;
+    // the size is stored modulo 2^32, like output counts
+    return !truncated && expectedCrc == ~crc && size == output;
+}
+
+size_t GzipSource::read(uint8_t *buffer, size_t length)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        if (matchLength)
+        {
+            uint8_t value = window[(output - matchDistance) & WINDOW_MASK];
+            window[output++ & WINDOW_MASK] = value;
+            crc = crcByte(crc, value);
+            buffer[done++] = value;
+            matchLength--;
+            continue;
+        }
+
+        switch (state)
+        {
+        case STATE_BLOCK:
+            if (lastBlock)
+            {
+                state = readTrailer() ? STATE_DONE : STATE_FAILED;
+            }
+            else if (!beginBlock() || truncated)
+            {
+                state = STATE_FAILED;
+            }
+            break;
+
+        case STATE_STORED:
+        {
+            if (!storedLeft)
+            {
+                state = STATE_BLOCK;
+                break;
+            }
+            int16_t value = nextByte();
+            if (value < 0)
+            {
+                state = STATE_FAILED;
+                break;
+            }
+            window[output++ & WINDOW_MASK] = value;
+            crc = crcByte(crc, value);
+            buffer[done++] = value;
+            storedLeft--;
+            break;
+        }
+
+        case STATE_HUFFMAN:
+        {
+            int16_t symbol = decode(lengthCode);
+            if (symbol < 0 || truncated)
+            {
+                state = STATE_FAILED;
+            }
+            else if (symbol < 256)
+            {
+                window[output++ & WINDOW_MASK] = symbol;
+                crc = crcByte(crc, symbol);
+                buffer[done++] = symbol;
+            }
+            else if (symbol == 256)
+            {
+                state = STATE_BLOCK;
+            }
+            else
+            {
+                // a match: copy length bytes from distance back
+                symbol -= 257;
+                if (symbol >= 29)
+                {
+                    state = STATE_FAILED;
+                    break;
+                }
+                uint16_t matched = lengthBase[symbol] + bits(lengthExtra[symbol]);
+                int16_t distance = decode(distanceCode);
+                if (distance < 0 || distance >= 30 || truncated)
+                {
+                    state = STATE_FAILED;
+                    break;
+                }
+                uint32_t back = distanceBase[distance] + bits(distanceExtra[distance]);
+                if (back > output || back > GZIP_WINDOW_SIZE)
+                {
+                    state = STATE_FAILED;
+                    break;
+                }
+                matchLength = matched;
+                matchDistance = back;
+            }
+            break;
+        }
+
+        default:
+            return done;
+        }
+    }
+    return done;
+}
@@ -0,0 +1,91 @@
+#ifndef GZIPSOURCE_H
+#define GZIPSOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bytestream.h"
+
+// deflate refers back up to this far, so it is the smallest window that
+// inflates any gzip file
+#define GZIP_WINDOW_SIZE 32768
+// compressed bytes read from the source at a time
+#define GZIP_INPUT_SIZE 1024
+
+// true for the start of a gzip file (deflate compressed)
+bool isGzipHeader(const uint8_t *header, size_t length);
+
+// Inflates a gzip file as it is read, so a compressed job prints without
+// being unpacked on the card first. Memory is fixed: the window and one
+// input buffer, allocated by begin(). Only the first member of a file is
+// read, as gzip writes them.
+class GzipSource : public ByteSource
+{
+public:
+    GzipSource(ByteSource &source);
+    ~GzipSource();
+
+    // reads the gzip header, the source must be at the start of the file;
+    // false if it is not gzip or there is no memory for the window.
+    // Can be called again to start over after seeking the source back.
+    bool begin();
+    // drops the next length inflated bytes, like resuming a job at an
+    // offset; false if there are fewer
+    bool skip(uint32_t length);
+
+    // the inflated bytes, 0 at the end or on corrupt or cut off data
+    size_t read(uint8_t *buffer, size_t length) override;
+
+    // the data ended where it should, and matched its length and checksum
+    bool isComplete() const { return state == STATE_DONE; }
+    bool hasFailed() const { return state == STATE_FAILED; }
+    // inflated bytes so far
+    uint32_t getOutput() const { return output; }
+
+private:
+    enum State
+    {
+        STATE_BLOCK,
+        STATE_STORED,
+        STATE_HUFFMAN,
+        STATE_DONE,
+        STATE_FAILED,
+    };
+
+    // a canonical Huffman code: codes per length, symbols ordered by code
+    struct Huffman
+    {
+        uint16_t counts[16];
+        uint16_t symbols[288];
+    };
+
+    int16_t nextByte();
+    uint32_t bits(uint8_t count);
+    int16_t decode(const Huffman &code);
+    static bool build(Huffman &code, const uint8_t *lengths, uint16_t count);
+    bool beginBlock();
+    bool readCodes();
+    bool readTrailer();
+    bool skipHeaderString();
+
+    ByteSource &source;
+    uint8_t *window;
+    uint8_t *input;
+    size_t inputLength, inputPosition;
+    // ran out of input in the middle of the data
+    bool truncated;
+
+    State state;
+    bool lastBlock;
+    uint32_t bitBuffer;
+    uint8_t bitCount;
+    Huffman lengthCode, distanceCode;
+    // left of a stored block, of a match being copied
+    uint16_t storedLeft, matchLength;
+    uint16_t matchDistance;
+
+    uint32_t output;
+    uint32_t crc;
+};
+
+#endif
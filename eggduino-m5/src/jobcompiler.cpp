@@ -0,0 +1,65 @@
+#include "jobcompiler.h"
+
+JobCompiler::JobCompiler(ByteSink &sink, uint16_t stepsPerRotation, JobEstimator *estimator)
+    : encoder(sink, stepsPerRotation),
+      estimator(estimator),
+      stepsPerRotation(stepsPerRotation),
+      length(0),
+      pending(false),
+      lines(0)
+{
+}
+
+bool JobCompiler::begin()
+{
+    return encoder.begin();
+}
+
+bool JobCompiler::compileLine()
+{
+    line[length] = 0;
+    Command cmd;
+    if (!length || !parseCommand(line, stepsPerRotation, cmd))
+    {
+        cmd.type = CMD_NONE;
+    }
+    length = 0;
+    pending = false;
+    lines++;
+    if (estimator)
+    {
+        estimator->add(cmd);
+    }
+    return encoder.write(cmd);
+}
+
+bool JobCompiler::write(const uint8_t *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        // a full line ends before the next byte, even if that is the new line
+        if (length == COMMAND_MAX_LENGTH && !compileLine())
+        {
+            return false;
+        }
+
+        pending = true;
+        if (data[i] == '\n')
+        {
+            if (!compileLine())
+            {
+                return false;
+            }
+        }
+        else
+        {
+            line[length++] = data[i];
+        }
+    }
+    return true;
+}
+
+bool JobCompiler::end()
+{
+    return pending ? compileLine() : true;
+}
@@ -0,0 +1,37 @@
+#ifndef JOBCOMPILER_H
+#define JOBCOMPILER_H
+
+#include "bytestream.h"
+#include "command.h"
+#include "eggbin.h"
+#include "estimator.h"
+
+// Compiles a text job into the binary format as its bytes arrive (e.g.
+// upload chunks). Lines are split exactly like TextJobReader splits them,
+// so the result prints the same moves as the text.
+class JobCompiler
+{
+public:
+    // every compiled line is also added to the estimator, if there is one
+    JobCompiler(ByteSink &sink, uint16_t stepsPerRotation, JobEstimator *estimator = NULL);
+
+    bool begin();
+    bool write(const uint8_t *data, size_t length);
+    // compiles whatever is left of the last line
+    bool end();
+
+    unsigned long getLines() const { return lines; }
+
+private:
+    bool compileLine();
+
+    EggBinaryEncoder encoder;
+    JobEstimator *estimator;
+    uint16_t stepsPerRotation;
+    char line[COMMAND_MAX_LENGTH + 1];
+    uint8_t length;
+    bool pending;
+    unsigned long lines;
+};
+
+#endif
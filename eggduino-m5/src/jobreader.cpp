@@ -0,0 +1,66 @@
+#include "jobreader.h"
+
+TextJobReader::TextJobReader(ByteSource &source, uint16_t stepsPerRotation)
+    : source(source),
+      stepsPerRotation(stepsPerRotation),
+      position(0),
+      length(0),
+      offset(0)
+{
+    current[0] = 0;
+}
+
+bool TextJobReader::readByte(uint8_t &value)
+{
+    if (position == length)
+    {
+        position = 0;
+        length = source.read(buffer, sizeof(buffer));
+        if (!length)
+        {
+            return false;
+        }
+    }
+    value = buffer[position++];
+    offset++;
+    return true;
+}
+
+bool TextJobReader::next(Command &cmd)
+{
+    uint8_t read = 0, value;
+    bool any = false;
+    while (read < COMMAND_MAX_LENGTH && readByte(value))
+    {
+        any = true;
+        if (value == '\n')
+        {
+            break;
+        }
+        current[read++] = value;
+    }
+    current[read] = 0;
+
+    if (!any)
+    {
+        return false;
+    }
+    if (!read || !parseCommand(current, stepsPerRotation, cmd))
+    {
+        cmd.type = CMD_NONE;
+    }
+    return true;
+}
+
+void TextJobReader::mark(JobMark &mark) const
+{
+    mark.offset = offset;
+    mark.position[0] = mark.position[1] = 0;
+    mark.stepsPerRotation = stepsPerRotation;
+}
+
+void TextJobReader::restore(const JobMark &mark)
+{
+    position = length = 0;
+    offset = mark.offset;
+}
@@ -0,0 +1,55 @@
+#ifndef JOBREADER_H
+#define JOBREADER_H
+
+#include "bytestream.h"
+#include "command.h"
+
+// a point in a job that reading can continue from
+struct JobMark
+{
+    // bytes of the source consumed up to here
+    uint32_t offset;
+    // binary jobs only: the last move in the job's steps and the job's steps per rotation
+    int32_t position[2];
+    uint16_t stepsPerRotation;
+};
+
+class JobReader
+{
+public:
+    virtual ~JobReader() {}
+    // reads the next line of the job; returns false at the end.
+    // lines that are not commands come back as CMD_NONE
+    virtual bool next(Command &cmd) = 0;
+
+    // marks the end of the last line read
+    virtual void mark(JobMark &mark) const = 0;
+    // continues from a mark; the source must already be positioned at mark.offset
+    virtual void restore(const JobMark &mark) = 0;
+};
+
+// reads the text .egg format, one command per line. Like readBytesUntil,
+// lines longer than COMMAND_MAX_LENGTH are split
+class TextJobReader : public JobReader
+{
+public:
+    TextJobReader(ByteSource &source, uint16_t stepsPerRotation);
+    bool next(Command &cmd) override;
+    void mark(JobMark &mark) const override;
+    void restore(const JobMark &mark) override;
+
+    // the raw text of the last line read
+    const char *line() const { return current; }
+
+private:
+    bool readByte(uint8_t &value);
+
+    ByteSource &source;
+    uint16_t stepsPerRotation;
+    uint8_t buffer[64];
+    size_t position, length;
+    uint32_t offset;
+    char current[COMMAND_MAX_LENGTH + 1];
+};
+
+#endif
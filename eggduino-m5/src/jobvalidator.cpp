@@ -0,0 +1,193 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jobvalidator.h"
+
+JobValidator::JobValidator(uint16_t stepsPerRotation, JobEstimator *estimator)
+    : estimator(estimator),
+      stepsPerRotation(stepsPerRotation),
+      length(0),
+      pending(false),
+      fileLines(0),
+      penUp(true),
+      anyMove(false),
+      x(0),
+      y(0),
+      errorLine(0),
+      error(NULL)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+// a number and nothing else up to end (a space or the end of the line)
+static bool readNumber(const char *text, char end, float &value)
+{
+    char *after;
+    value = strtof(text, &after);
+    return after != text && *after == end && isfinite(value);
+}
+
+const char *JobValidator::findError(Command &cmd, float &moveX, float &moveY)
+{
+    if (!length)
+    {
+        cmd.type = CMD_NONE;
+        return NULL;
+    }
+    if (line[length - 1] == '\r')
+    {
+        return "ends with a carriage return";
+    }
+    if (!parseCommand(line, stepsPerRotation, cmd))
+    {
+        return "unknown command";
+    }
+
+    // parseCommand reads the known ones leniently, the job must say what
+    // it means
+    float value;
+    switch (cmd.type)
+    {
+    case CMD_MOVE:
+    {
+        const char *space = strchr(&line[2], ' ');
+        if (line[1] != ' ' || !readNumber(&line[2], ' ', moveX) || !readNumber(space + 1, 0, moveY))
+        {
+            return "a move needs T <x> <y>";
+        }
+        break;
+    }
+    case CMD_PROGRESS:
+        if (line[1] && (line[1] != ' ' || !readNumber(&line[2], 0, value) || value < 0 || value > 100))
+        {
+            return "progress needs Z <0-100>";
+        }
+        break;
+    case CMD_WAIT:
+        if (line[1] && line[1] != ' ')
+        {
+            return "unknown command";
+        }
+        break;
+    default:
+        break;
+    }
+    return NULL;
+}
+
+void JobValidator::addMove(float toX, float toY)
+{
+    float dx = toX - x, dy = toY - y;
+    if (penUp)
+    {
+        // travel takes the shorter way round
+        dx = remainderf(dx, 360.0f);
+    }
+    float distance = sqrtf(dx * dx + dy * dy);
+    if (penUp)
+    {
+        stats.travelDistance += distance;
+    }
+    else
+    {
+        stats.drawDistance += distance;
+    }
+    x = toX;
+    y = toY;
+
+    if (!anyMove)
+    {
+        stats.minX = stats.maxX = x;
+        stats.minY = stats.maxY = y;
+        anyMove = true;
+    }
+    stats.minX = fminf(stats.minX, x);
+    stats.maxX = fmaxf(stats.maxX, x);
+    stats.minY = fminf(stats.minY, y);
+    stats.maxY = fmaxf(stats.maxY, y);
+}
+
+bool JobValidator::checkLine()
+{
+    line[length] = 0;
+    Command cmd;
+    float moveX, moveY;
+    const char *problem = findError(cmd, moveX, moveY);
+    length = 0;
+    pending = false;
+    stats.lines++;
+    if (problem)
+    {
+        errorLine = fileLines + 1;
+        error = problem;
+        return false;
+    }
+
+    if (estimator)
+    {
+        estimator->add(cmd);
+    }
+    switch (cmd.type)
+    {
+    case CMD_MOVE:
+        addMove(moveX, moveY);
+        break;
+    case CMD_PEN_UP:
+        stats.penLifts += penUp ? 0 : 1;
+        penUp = true;
+        break;
+    case CMD_PEN_DOWN:
+        penUp = false;
+        break;
+    case CMD_HOME:
+        x = y = 0;
+        break;
+    case CMD_WAIT:
+        if (stats.layerCount < JOB_STATS_LAYERS)
+        {
+            memcpy(stats.layers[stats.layerCount], cmd.text, sizeof(cmd.text));
+        }
+        stats.layerCount++;
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+bool JobValidator::write(const uint8_t *data, size_t size)
+{
+    for (size_t i = 0; i < size && !error; i++)
+    {
+        if (length == COMMAND_MAX_LENGTH)
+        {
+            if (data[i] != '\n')
+            {
+                errorLine = fileLines + 1;
+                error = "longer than 30 characters";
+                break;
+            }
+            // the reader splits the line here, the new line then ends an
+            // empty one; line numbers count both, like printing does
+            checkLine();
+        }
+
+        pending = true;
+        if (data[i] == '\n')
+        {
+            checkLine();
+            fileLines++;
+        }
+        else
+        {
+            line[length++] = data[i];
+        }
+    }
+    return !error;
+}
+
+bool JobValidator::end()
+{
+    return error ? false : pending ? checkLine() : true;
+}
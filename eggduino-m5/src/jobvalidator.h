@@ -0,0 +1,70 @@
+#ifndef JOBVALIDATOR_H
+#define JOBVALIDATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "command.h"
+#include "estimator.h"
+
+// S line names kept, the rest are only counted
+#define JOB_STATS_LAYERS 8
+
+// What a job does, known without printing it. Positions and distances are
+// in degrees of the job, travel taking the shorter way round like the
+// printer does.
+struct JobStats
+{
+    uint32_t lines;
+    uint32_t penLifts;
+    uint16_t layerCount;
+    char layers[JOB_STATS_LAYERS][COMMAND_MAX_LENGTH + 1];
+    // of the moves, all zero if there are none
+    float minX, minY, maxX, maxY;
+    float drawDistance, travelDistance;
+};
+
+// Checks a text job line by line as its bytes arrive (e.g. upload chunks)
+// and collects its JobStats. Lines are split like TextJobReader splits
+// them, and any line it would not read as written is an error: too long
+// (it would be split), not a command, or a command with bad numbers.
+class JobValidator
+{
+public:
+    // every line is also added to the estimator, if there is one
+    JobValidator(uint16_t stepsPerRotation, JobEstimator *estimator = NULL);
+
+    // false from the first bad line on
+    bool write(const uint8_t *data, size_t length);
+    // checks whatever is left of the last line
+    bool end();
+
+    const JobStats &getStats() const { return stats; }
+    // the first bad line (from 1) and what is wrong with it, 0 and NULL if
+    // there is none
+    uint32_t getErrorLine() const { return errorLine; }
+    const char *getError() const { return error; }
+
+private:
+    bool checkLine();
+    // a move's position in degrees goes to moveX, moveY
+    const char *findError(Command &cmd, float &moveX, float &moveY);
+    void addMove(float x, float y);
+
+    JobEstimator *estimator;
+    uint16_t stepsPerRotation;
+    char line[COMMAND_MAX_LENGTH + 1];
+    uint8_t length;
+    bool pending;
+    // new lines so far, error lines count these
+    uint32_t fileLines;
+
+    JobStats stats;
+    bool penUp, anyMove;
+    float x, y;
+
+    uint32_t errorLine;
+    const char *error;
+};
+
+#endif
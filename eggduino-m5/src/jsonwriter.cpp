@@ -0,0 +1,234 @@
+#include <string.h>
+
+#include "jsonwriter.h"
+
+JsonWriter::JsonWriter(char *buffer, size_t size)
+    : buffer(buffer),
+      size(size),
+      state{0, 0, 0, false, false}
+{
+    if (size)
+    {
+        buffer[0] = 0;
+    }
+}
+
+JsonWriter::JsonWriter(char *buffer, size_t size, const State &continued)
+    : JsonWriter(buffer, size)
+{
+    state.hasItems = continued.hasItems;
+    state.depth = continued.depth;
+    state.afterKey = continued.afterKey;
+}
+
+void JsonWriter::restore(const State &saved)
+{
+    state = saved;
+    if (state.length < size)
+    {
+        buffer[state.length] = 0;
+    }
+}
+
+void JsonWriter::write(char c)
+{
+    write(&c, 1);
+}
+
+void JsonWriter::write(const char *text, size_t length)
+{
+    if (state.overflow)
+    {
+        return;
+    }
+    // one byte is kept for the terminator
+    if (state.length + length >= size)
+    {
+        state.overflow = true;
+        return;
+    }
+    memcpy(buffer + state.length, text, length);
+    state.length += length;
+    buffer[state.length] = 0;
+}
+
+void JsonWriter::writeEscaped(const char *text, size_t length)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *plain = text;
+    const char *end = text + length;
+    for (; text < end; text++)
+    {
+        uint8_t c = *text;
+        if (c >= 0x20 && c != '"' && c != '\\')
+        {
+            continue;
+        }
+
+        write(plain, text - plain);
+        plain = text + 1;
+        switch (c)
+        {
+        case '"':
+            write("\\\"", 2);
+            break;
+        case '\\':
+            write("\\\\", 2);
+            break;
+        case '\n':
+            write("\\n", 2);
+            break;
+        case '\r':
+            write("\\r", 2);
+            break;
+        case '\t':
+            write("\\t", 2);
+            break;
+        default:
+        {
+            char escaped[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+            write(escaped, sizeof(escaped));
+            break;
+        }
+        }
+    }
+    write(plain, end - plain);
+}
+
+void JsonWriter::writeNumber(unsigned long number, bool negative)
+{
+    char digits[21];
+    char *start = digits + sizeof(digits);
+    do
+    {
+        *--start = '0' + number % 10;
+        number /= 10;
+    } while (number);
+    if (negative)
+    {
+        *--start = '-';
+    }
+    write(start, digits + sizeof(digits) - start);
+}
+
+void JsonWriter::separate()
+{
+    if (state.afterKey)
+    {
+        state.afterKey = false;
+        return;
+    }
+    if (!state.depth)
+    {
+        return;
+    }
+    uint32_t bit = 1UL << (state.depth - 1);
+    if (state.hasItems & bit)
+    {
+        write(',');
+    }
+    state.hasItems |= bit;
+}
+
+void JsonWriter::begin(char bracket)
+{
+    separate();
+    write(bracket);
+    if (state.depth < 32)
+    {
+        state.depth++;
+        state.hasItems &= ~(1UL << (state.depth - 1));
+    }
+}
+
+void JsonWriter::end(char bracket)
+{
+    if (state.depth)
+    {
+        state.depth--;
+    }
+    write(bracket);
+}
+
+JsonWriter &JsonWriter::beginObject()
+{
+    begin('{');
+    return *this;
+}
+
+JsonWriter &JsonWriter::endObject()
+{
+    end('}');
+    return *this;
+}
+
+JsonWriter &JsonWriter::beginArray()
+{
+    begin('[');
+    return *this;
+}
+
+JsonWriter &JsonWriter::endArray()
+{
+    end(']');
+    return *this;
+}
+
+JsonWriter &JsonWriter::key(const char *name)
+{
+    separate();
+    write('"');
+    writeEscaped(name, strlen(name));
+    write("\":", 2);
+    state.afterKey = true;
+    return *this;
+}
+
+JsonWriter &JsonWriter::value(const char *text)
+{
+    return value(text, strlen(text));
+}
+
+JsonWriter &JsonWriter::value(const char *text, size_t length)
+{
+    separate();
+    write('"');
+    writeEscaped(text, length);
+    write('"');
+    return *this;
+}
+
+JsonWriter &JsonWriter::value(long number)
+{
+    separate();
+    writeNumber(number < 0 ? 0UL - (unsigned long)number : number, number < 0);
+    return *this;
+}
+
+JsonWriter &JsonWriter::value(unsigned long number)
+{
+    separate();
+    writeNumber(number, false);
+    return *this;
+}
+
+JsonWriter &JsonWriter::value(bool flag)
+{
+    separate();
+    if (flag)
+    {
+        write("true", 4);
+    }
+    else
+    {
+        write("false", 5);
+    }
+    return *this;
+}
+
+JsonWriter &JsonWriter::null()
+{
+    separate();
+    write("null", 4);
+    return *this;
+}
@@ -0,0 +1,69 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Writes JSON straight into a caller supplied buffer, without allocating.
+// Commas are inserted between members and array items, strings are escaped.
+// Output that does not fit is cut off and overflowed() turns true; a saved
+// state can be restored to drop a partly written item. The buffer is always
+// zero terminated.
+class JsonWriter
+{
+public:
+    struct State
+    {
+        size_t length;
+        // bit per nesting level: the container already has an item
+        uint32_t hasItems;
+        uint8_t depth;
+        bool afterKey;
+        bool overflow;
+    };
+
+    JsonWriter(char *buffer, size_t size);
+    // continues a document that was started in an earlier buffer (chunked
+    // responses); only the nesting of the state is used
+    JsonWriter(char *buffer, size_t size, const State &state);
+
+    JsonWriter &beginObject();
+    JsonWriter &endObject();
+    JsonWriter &beginArray();
+    JsonWriter &endArray();
+    JsonWriter &key(const char *name);
+
+    JsonWriter &value(const char *text);
+    JsonWriter &value(const char *text, size_t length);
+    JsonWriter &value(int number) { return value((long)number); }
+    JsonWriter &value(unsigned int number) { return value((unsigned long)number); }
+    JsonWriter &value(long number);
+    JsonWriter &value(unsigned long number);
+    JsonWriter &value(bool flag);
+    JsonWriter &null();
+
+    template <typename T>
+    JsonWriter &member(const char *name, T item) { return key(name).value(item); }
+
+    State save() const { return state; }
+    void restore(const State &saved);
+
+    const char *c_str() const { return buffer; }
+    size_t length() const { return state.length; }
+    bool overflowed() const { return state.overflow; }
+
+private:
+    void separate();
+    void begin(char bracket);
+    void end(char bracket);
+    void write(char c);
+    void write(const char *text, size_t length);
+    void writeEscaped(const char *text, size_t length);
+    void writeNumber(unsigned long number, bool negative);
+
+    char *buffer;
+    size_t size;
+    State state;
+};
+
+#endif
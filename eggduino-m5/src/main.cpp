@@ -58,10 +58,30 @@ void loop()
     }
   }
 
+  web.loop();
   M5.update();
 
-  if (M5.BtnA.wasPressed() || M5.BtnB.wasPressed() || M5.BtnC.wasPressed())
+  if (printer.isPaused())
   {
-    printer.continuePrint();
+    if (M5.BtnA.wasPressed() || M5.BtnB.wasPressed() || M5.BtnC.wasPressed())
+    {
+      printer.continuePrint();
+    }
+  }
+  else if (printer.isPrinting())
+  {
+    // slower, back to 100%, faster
+    if (M5.BtnA.wasPressed())
+    {
+      printer.setFeedOverride(printer.getFeedOverride() - FEED_OVERRIDE_STEP);
+    }
+    if (M5.BtnB.wasPressed())
+    {
+      printer.setFeedOverride(100);
+    }
+    if (M5.BtnC.wasPressed())
+    {
+      printer.setFeedOverride(printer.getFeedOverride() + FEED_OVERRIDE_STEP);
+    }
   }
 }
\ No newline at end of file
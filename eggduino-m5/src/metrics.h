@@ -0,0 +1,70 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// bucket i counts durations of [2^i, 2^(i+1)) us, the first one also 0 and
+// the last one everything longer (from about half a second)
+#define METRICS_BUCKETS 20
+
+// How long something took, each time it happened. Fixed size, cheap enough
+// to add to from the print loop; written by the print tasks and read by the
+// web layer without a lock, so a reading can be a sample or two behind.
+struct Histogram
+{
+    uint32_t count, max;
+    uint64_t total;
+    uint32_t buckets[METRICS_BUCKETS];
+
+    void reset()
+    {
+        count = max = 0;
+        total = 0;
+        memset(buckets, 0, sizeof(buckets));
+    }
+
+    void add(uint32_t us)
+    {
+        uint8_t bucket = us ? 31 - __builtin_clz(us) : 0;
+        buckets[bucket < METRICS_BUCKETS ? bucket : METRICS_BUCKETS - 1]++;
+        count++;
+        total += us;
+        if (us > max)
+        {
+            max = us;
+        }
+    }
+};
+
+// Where the time of a print goes, from its start. Timed with the cycle
+// counter, which is per core: the print tasks all run on core 0. It wraps
+// after some seconds at full clock, longer than anything timed here.
+struct PrintMetrics
+{
+    // job file reads (read task), commands read from the job (includes
+    // waiting for the read task), planning a move
+    Histogram read, parse, plan;
+    // blocked on the step queue or the end of motion, on the pen servo
+    Histogram motionWait, penWait;
+    // least free stack seen of the print tasks, bytes
+    uint32_t printStack, readStack, penStack;
+    uint32_t cyclesPerMicro;
+
+    void reset()
+    {
+        read.reset();
+        parse.reset();
+        plan.reset();
+        motionWait.reset();
+        penWait.reset();
+        printStack = readStack = penStack = 0;
+        cyclesPerMicro = ESP.getCpuFreqMHz();
+    }
+
+    uint32_t now() const { return ESP.getCycleCount(); }
+    // us since a now()
+    uint32_t since(uint32_t start) const { return (ESP.getCycleCount() - start) / cyclesPerMicro; }
+};
+
+#endif
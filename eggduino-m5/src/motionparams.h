@@ -0,0 +1,93 @@
+#ifndef MOTIONPARAMS_H
+#define MOTIONPARAMS_H
+
+#include <stdint.h>
+
+// saved with the parameters; bump it when MotionParameters changes and
+// convert the layout before it in Printer::getParameters
+#define MOTION_PARAMETERS_VERSION 1
+
+struct MotionParameters
+{
+    uint8_t penUpPercent, penDownPercent;
+    uint16_t drawingSpeed, travelSpeed;
+    // ms the servo takes to lift the pen, and to lower it
+    uint16_t penUpDelay, penDownDelay;
+    // ms motion goes on while the pen moves: travel starts before a lift is
+    // done and lowering starts before the travel there is
+    uint16_t penOverlap;
+    uint16_t stepsPerRotation;
+    bool reverseRotation, reversePen;
+    uint16_t acceleration;
+    uint16_t junctionDeviation;
+    // steps/s the axes start, stop and turn at without ramping, as every
+    // move did before acceleration; only faster moves ramp up to speed
+    uint16_t startSpeed;
+    // drawing moves also take the shorter way round the egg (travel always does)
+    bool wrapDrawing;
+    // moves are left out while the path stays this close, in steps (0 keeps them)
+    uint16_t pathTolerance;
+    // drawing moves starting a straight run of straightRun steps go up to
+    // maxDrawingSpeed, shorter runs proportionally less down to drawingSpeed
+    // (at or below drawingSpeed: every drawing move at drawingSpeed)
+    uint16_t maxDrawingSpeed;
+    uint16_t straightRun;
+};
+
+// as saved before the parameters had a version
+struct MotionParametersV0
+{
+    uint8_t penUpPercent, penDownPercent;
+    uint16_t drawingSpeed, travelSpeed;
+    uint16_t penMoveDelay;
+    uint16_t stepsPerRotation;
+    bool reverseRotation, reversePen;
+};
+
+inline void getDefaultParameters(MotionParameters &params)
+{
+    params.penDownPercent = 70;
+    params.penUpPercent = 40;
+    params.drawingSpeed = 500;
+    params.travelSpeed = 2000;
+    params.penUpDelay = 150;
+    params.penDownDelay = 150;
+    params.penOverlap = 40;
+    params.stepsPerRotation = 6400;
+    params.reversePen = false;
+    params.reverseRotation = false;
+    params.acceleration = 4000;
+    params.junctionDeviation = 2;
+    params.startSpeed = 2000;
+    params.wrapDrawing = false;
+    params.pathTolerance = 1;
+    params.maxDrawingSpeed = 1000;
+    params.straightRun = 400;
+}
+
+// true if jobs take the same time with both
+inline bool hasSameTiming(const MotionParameters &a, const MotionParameters &b)
+{
+    return a.drawingSpeed == b.drawingSpeed &&
+           a.travelSpeed == b.travelSpeed &&
+           a.penUpDelay == b.penUpDelay &&
+           a.penDownDelay == b.penDownDelay &&
+           a.penOverlap == b.penOverlap &&
+           a.stepsPerRotation == b.stepsPerRotation &&
+           a.acceleration == b.acceleration &&
+           a.junctionDeviation == b.junctionDeviation &&
+           a.startSpeed == b.startSpeed &&
+           a.wrapDrawing == b.wrapDrawing &&
+           a.pathTolerance == b.pathTolerance &&
+           a.maxDrawingSpeed == b.maxDrawingSpeed &&
+           a.straightRun == b.straightRun;
+}
+
+// ms a whole pen move adds to a print, the overlap goes on moving
+inline uint16_t penMoveTime(const MotionParameters &params, bool up)
+{
+    uint16_t time = up ? params.penUpDelay : params.penDownDelay;
+    return time > params.penOverlap ? time - params.penOverlap : 0;
+}
+
+#endif
@@ -0,0 +1,150 @@
+#include "pathfilter.h"
+
+PathFilter::PathFilter()
+{
+    begin(0, 0, 0);
+}
+
+void PathFilter::begin(uint16_t tolerance, int32_t x, int32_t y)
+{
+    tolerance2 = (uint32_t)tolerance * tolerance;
+    readyCount = readyNext = 0;
+    merged = simplified = 0;
+    setPosition(x, y);
+}
+
+void PathFilter::setPosition(int32_t x, int32_t y)
+{
+    points[0][0] = x;
+    points[0][1] = y;
+    count = 1;
+}
+
+void PathFilter::add(int32_t x, int32_t y)
+{
+    if (points[count - 1][0] == x && points[count - 1][1] == y)
+    {
+        merged++;
+        return;
+    }
+
+    points[count][0] = x;
+    points[count][1] = y;
+    if (++count == PATH_FILTER_WINDOW + 1)
+    {
+        simplify();
+    }
+}
+
+void PathFilter::flush()
+{
+    if (count > 1)
+    {
+        simplify();
+    }
+}
+
+bool PathFilter::next(int32_t &x, int32_t &y)
+{
+    if (readyNext == readyCount)
+    {
+        readyCount = readyNext = 0;
+        return false;
+    }
+    x = ready[readyNext][0];
+    y = ready[readyNext][1];
+    readyNext++;
+    return true;
+}
+
+void PathFilter::simplify()
+{
+    uint8_t last = count - 1;
+    for (uint8_t i = 1; i < last; i++)
+    {
+        keep[i] = !tolerance2;
+    }
+    keep[last] = true;
+
+    // split at the point farthest off the line until every part is within
+    // tolerance; the parts pending never overlap, so there are fewer than
+    // the window holds
+    uint8_t pending[PATH_FILTER_WINDOW][2];
+    uint8_t pendingCount = 0;
+    if (tolerance2 && last > 1)
+    {
+        pending[pendingCount][0] = 0;
+        pending[pendingCount][1] = last;
+        pendingCount++;
+    }
+    while (pendingCount)
+    {
+        pendingCount--;
+        uint8_t from = pending[pendingCount][0], to = pending[pendingCount][1];
+        uint8_t farthest = 0;
+        float farthestDistance2 = tolerance2;
+        for (uint8_t i = from + 1; i < to; i++)
+        {
+            float d2 = distance2(from, to, i);
+            if (d2 > farthestDistance2)
+            {
+                farthest = i;
+                farthestDistance2 = d2;
+            }
+        }
+        if (!farthest)
+        {
+            continue;
+        }
+        keep[farthest] = true;
+        if (farthest - from > 1)
+        {
+            pending[pendingCount][0] = from;
+            pending[pendingCount][1] = farthest;
+            pendingCount++;
+        }
+        if (to - farthest > 1)
+        {
+            pending[pendingCount][0] = farthest;
+            pending[pendingCount][1] = to;
+            pendingCount++;
+        }
+    }
+
+    for (uint8_t i = 1; i <= last; i++)
+    {
+        if (keep[i])
+        {
+            ready[readyCount][0] = points[i][0];
+            ready[readyCount][1] = points[i][1];
+            readyCount++;
+        }
+        else
+        {
+            simplified++;
+        }
+    }
+    setPosition(points[last][0], points[last][1]);
+}
+
+float PathFilter::distance2(uint8_t from, uint8_t to, uint8_t point) const
+{
+    // to the segment, not the line: a point past either end is as far as
+    // that end is
+    int64_t dx = points[to][0] - points[from][0], dy = points[to][1] - points[from][1];
+    int64_t vx = points[point][0] - points[from][0], vy = points[point][1] - points[from][1];
+    int64_t dot = dx * vx + dy * vy;
+    int64_t length2 = dx * dx + dy * dy;
+    if (dot <= 0 || !length2)
+    {
+        return (float)(vx * vx + vy * vy);
+    }
+    if (dot >= length2)
+    {
+        int64_t wx = vx - dx, wy = vy - dy;
+        return (float)(wx * wx + wy * wy);
+    }
+    // the cross product in integers, nearly straight lines cancel out in it
+    float cross = (float)(dx * vy - dy * vx);
+    return cross * cross / (float)length2;
+}
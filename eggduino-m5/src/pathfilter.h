@@ -0,0 +1,54 @@
+#ifndef PATHFILTER_H
+#define PATHFILTER_H
+
+#include <stdint.h>
+
+// moves simplified together; the last one of a window is always kept
+#define PATH_FILTER_WINDOW 32
+
+// Thins out the moves between the job reader and the motion code.
+//
+// A move to the step the previous one ended on is merged into it. The
+// others are collected in windows of PATH_FILTER_WINDOW and simplified
+// Douglas-Peucker style: a move is left out when the path stays within
+// tolerance steps of where it would have gone. Positions are in the job
+// (whole turns are not wrapped), so a window is one polyline as drawn.
+class PathFilter
+{
+public:
+    PathFilter();
+
+    // tolerance 0 only merges; x, y is where the job starts
+    void begin(uint16_t tolerance, int32_t x, int32_t y);
+    // the job continues from x, y (after H, with nothing held back)
+    void setPosition(int32_t x, int32_t y);
+
+    void add(int32_t x, int32_t y);
+    // all moves added so far are final, e.g. before a command that is not one
+    void flush();
+    // the moves to make, in order; take them all after every add or flush
+    bool next(int32_t &x, int32_t &y);
+    // nothing held back
+    bool isEmpty() const { return count == 1 && readyNext == readyCount; }
+
+    uint32_t getMerged() const { return merged; }
+    uint32_t getSimplified() const { return simplified; }
+
+private:
+    void simplify();
+    // squared steps from point to the segment between from and to
+    float distance2(uint8_t from, uint8_t to, uint8_t point) const;
+
+    uint32_t tolerance2;
+    // points[0] is where the window starts, already moved to
+    int32_t points[PATH_FILTER_WINDOW + 1][2];
+    uint8_t count;
+    bool keep[PATH_FILTER_WINDOW + 1];
+
+    int32_t ready[PATH_FILTER_WINDOW][2];
+    uint8_t readyCount, readyNext;
+
+    uint32_t merged, simplified;
+};
+
+#endif
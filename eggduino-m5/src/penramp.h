@@ -0,0 +1,122 @@
+#ifndef PENRAMP_H
+#define PENRAMP_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+
+// Where the pen servo is while it moves. A move goes from wherever the pen
+// is to its new duty in a straight ramp, taking the calibrated time of its
+// direction for the whole way between up and down and its share of that for
+// less. The servo is driven along the ramp, so it is there when the ramp is.
+//
+// Moves are started from any task (the print task, web requests) and
+// followed from others. Starting ones take turns on a mutex; following ones
+// take no lock: each new ramp goes to the slot not being followed and a
+// sequence number says which is current, a follower retries if one was
+// started while it read.
+class PenRamp
+{
+public:
+    PenRamp() : upDuty(0), downDuty(0), upTime(0), downTime(0), placed(false), sequence(0)
+    {
+        ramps[0] = ramps[1] = {0, 0, 0, 0};
+    }
+
+    // a whole move up and down takes upTime and downTime ms
+    void setTimings(uint16_t upDuty, uint16_t downDuty, uint16_t upTime, uint16_t downTime)
+    {
+        std::lock_guard<std::mutex> lock(moving);
+        this->upDuty = upDuty;
+        this->downDuty = downDuty;
+        this->upTime = upTime;
+        this->downTime = downTime;
+    }
+
+    // the first move cannot know where the pen was left, it goes straight there
+    void move(bool up, uint32_t now)
+    {
+        std::lock_guard<std::mutex> lock(moving);
+        uint16_t to = up ? upDuty : downDuty;
+        if (!placed)
+        {
+            placed = true;
+            publish({to, to, now, 0});
+            return;
+        }
+        uint16_t from = dutyAt(now);
+        uint32_t whole = up ? upTime : downTime;
+        uint32_t span = upDuty > downDuty ? upDuty - downDuty : downDuty - upDuty;
+        uint32_t distance = from > to ? from - to : to - from;
+        publish({from, to, now, span ? (whole * distance + span - 1) / span : 0});
+    }
+
+    uint16_t dutyAt(uint32_t now) const
+    {
+        Ramp ramp = read();
+        uint32_t elapsed = now - ramp.start;
+        if (elapsed >= ramp.duration)
+        {
+            return ramp.to;
+        }
+        return ramp.from + ((int32_t)ramp.to - ramp.from) * (int32_t)elapsed / (int32_t)ramp.duration;
+    }
+
+    // how far up the pen is, 0 down to 255 up
+    uint8_t heightAt(uint32_t now) const
+    {
+        int32_t span = (int32_t)upDuty - downDuty;
+        if (!span)
+        {
+            return 255;
+        }
+        int32_t height = ((int32_t)dutyAt(now) - downDuty) * 255 / span;
+        return height < 0 ? 0 : height > 255 ? 255 : height;
+    }
+
+    // ms until the pen is where it was sent
+    uint32_t remaining(uint32_t now) const
+    {
+        Ramp ramp = read();
+        uint32_t elapsed = now - ramp.start;
+        return elapsed >= ramp.duration ? 0 : ramp.duration - elapsed;
+    }
+
+private:
+    struct Ramp
+    {
+        uint16_t from, to;
+        uint32_t start, duration;
+    };
+
+    // with moving held
+    void publish(const Ramp &ramp)
+    {
+        uint32_t next = sequence.load(std::memory_order_relaxed) + 1;
+        ramps[next & 1] = ramp;
+        sequence.store(next, std::memory_order_release);
+    }
+
+    Ramp read() const
+    {
+        uint32_t before, after;
+        Ramp ramp;
+        do
+        {
+            before = sequence.load(std::memory_order_acquire);
+            ramp = ramps[before & 1];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while (before != after);
+        return ramp;
+    }
+
+    std::mutex moving;
+    uint16_t upDuty, downDuty, upTime, downTime;
+    bool placed;
+    // the current ramp is ramps[sequence & 1]
+    Ramp ramps[2];
+    std::atomic<uint32_t> sequence;
+};
+
+#endif
@@ -0,0 +1,184 @@
+#include <math.h>
+#include <stdlib.h>
+#include "planner.h"
+
+// cosine limits between which the junction deviation formula is used;
+// outside them the corner is treated as a full stop or a straight line
+#define JUNCTION_REVERSAL 0.999f
+#define JUNCTION_STRAIGHT -0.999f
+
+Planner::Planner()
+    : head(0), tail(0), acceleration(0), junctionDeviation(0), startSpeed(0)
+{
+    setPosition(0, 0);
+}
+
+void Planner::setPosition(int32_t x, int32_t y)
+{
+    clear();
+    position[0] = x;
+    position[1] = y;
+}
+
+void Planner::clear()
+{
+    head = tail = 0;
+    previousUnit[0] = previousUnit[1] = 0;
+    previousNominalSpeed = 0;
+    previousStopSpeed = 0;
+}
+
+bool Planner::push(int32_t x, int32_t y, float speed)
+{
+    if (isFull())
+    {
+        return false;
+    }
+
+    int32_t dx = x - position[0];
+    int32_t dy = y - position[1];
+    if (!dx && !dy)
+    {
+        return true;
+    }
+
+    PlannerBlock &block = blocks[head];
+    block.target[0] = x;
+    block.target[1] = y;
+    block.steps[0] = dx;
+    block.steps[1] = dy;
+    block.stepEventCount = labs(dx) > labs(dy) ? labs(dx) : labs(dy);
+    block.length = sqrtf((float)dx * dx + (float)dy * dy);
+    block.unit[0] = dx / block.length;
+    block.unit[1] = dy / block.length;
+    block.nominalSpeed = speed * block.length / block.stepEventCount;
+    // the axis that moves the most goes at startSpeed
+    float fastest = fmaxf(fabsf(block.unit[0]), fabsf(block.unit[1]));
+    block.stopSpeed = fminf(block.nominalSpeed, startSpeed / fastest);
+
+    if (isEmpty())
+    {
+        // whatever ran before has been planned to stop
+        block.maxEntrySpeed = block.stopSpeed;
+    }
+    else
+    {
+        float cosTheta = -(previousUnit[0] * block.unit[0] + previousUnit[1] * block.unit[1]);
+        float vmax = 0;
+        if (cosTheta < JUNCTION_REVERSAL)
+        {
+            vmax = fminf(previousNominalSpeed, block.nominalSpeed);
+            if (cosTheta > JUNCTION_STRAIGHT && acceleration > 0)
+            {
+                float sinHalfTheta = sqrtf(0.5f * (1.0f - cosTheta));
+                vmax = fminf(vmax, sqrtf(acceleration * junctionDeviation * sinHalfTheta / (1.0f - sinHalfTheta)));
+            }
+        }
+        // any corner can be taken as fast as stopping and starting again,
+        // no axis changes speed by more than that
+        block.maxEntrySpeed = fmaxf(vmax, fminf(previousStopSpeed, block.stopSpeed));
+    }
+    block.entrySpeed = block.maxEntrySpeed;
+
+    previousUnit[0] = block.unit[0];
+    previousUnit[1] = block.unit[1];
+    previousNominalSpeed = block.nominalSpeed;
+    previousStopSpeed = block.stopSpeed;
+    position[0] = x;
+    position[1] = y;
+
+    head = next(head);
+    recalculate();
+    return true;
+}
+
+void Planner::discardCurrent()
+{
+    if (!isEmpty())
+    {
+        tail = next(tail);
+    }
+}
+
+float Planner::maxSpeedFrom(float speed, float distance) const
+{
+    if (acceleration <= 0)
+    {
+        return INFINITY;
+    }
+    return sqrtf(speed * speed + 2 * acceleration * distance);
+}
+
+void Planner::recalculate()
+{
+    uint8_t last = prev(head);
+
+    // reverse pass: every block must be able to decelerate into the next one,
+    // and the newest one to a stop. The oldest block's entry speed is
+    // already committed, so it is left untouched
+    float nextEntry = blocks[last].stopSpeed;
+    for (uint8_t i = last; i != tail; i = prev(i))
+    {
+        PlannerBlock &block = blocks[i];
+        block.entrySpeed = fminf(block.maxEntrySpeed, maxSpeedFrom(nextEntry, block.length));
+        nextEntry = block.entrySpeed;
+    }
+
+    // forward pass: no block can be entered faster than the previous one
+    // can accelerate to
+    for (uint8_t i = tail; i != last; i = next(i))
+    {
+        PlannerBlock &block = blocks[i];
+        PlannerBlock &following = blocks[next(i)];
+        following.entrySpeed = fminf(following.entrySpeed, maxSpeedFrom(block.entrySpeed, block.length));
+    }
+
+    for (uint8_t i = tail; i != head; i = next(i))
+    {
+        bool stops = i == last;
+        calculateTrapezoid(blocks[i], stops ? blocks[i].stopSpeed : blocks[next(i)].entrySpeed, stops);
+    }
+}
+
+void Planner::calculateTrapezoid(PlannerBlock &block, float exitSpeed, bool stops)
+{
+    block.stops = stops;
+    float factor = block.stepEventCount / block.length;
+    block.initialRate = block.entrySpeed * factor;
+    block.finalRate = exitSpeed * factor;
+    block.nominalRate = block.nominalSpeed * factor;
+    block.accelerationRate = acceleration * factor;
+}
+
+float Planner::rateAt(const PlannerBlock &block, uint32_t step)
+{
+    if (block.accelerationRate <= 0)
+    {
+        return block.nominalRate;
+    }
+
+    // the lowest of cruising, accelerating from the start and
+    // decelerating to the end gives the trapezoid (or triangle)
+    float accelerating = block.initialRate * block.initialRate + 2 * block.accelerationRate * (step + 1);
+    float decelerating = block.finalRate * block.finalRate + 2 * block.accelerationRate * (block.stepEventCount - step);
+    return fminf(block.nominalRate, sqrtf(fminf(accelerating, decelerating)));
+}
+
+float Planner::duration(const PlannerBlock &block)
+{
+    float steps = block.stepEventCount;
+    float acceleration = block.accelerationRate;
+    if (acceleration <= 0)
+    {
+        return steps / block.nominalRate;
+    }
+
+    // the profile peaks where accelerating and decelerating meet,
+    // unless it reaches the nominal rate before that
+    float initial = block.initialRate, final = block.finalRate;
+    float peak = fminf(block.nominalRate, sqrtf((2 * acceleration * steps + initial * initial + final * final) / 2));
+    float accelerating = (peak * peak - initial * initial) / (2 * acceleration);
+    float decelerating = (peak * peak - final * final) / (2 * acceleration);
+    float cruising = fmaxf(0, steps - accelerating - decelerating);
+    return (fmaxf(0, peak - initial) + fmaxf(0, peak - final)) / acceleration + cruising / peak;
+}
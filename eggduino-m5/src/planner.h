@@ -0,0 +1,83 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include <stdint.h>
+
+#define PLANNER_BUFFER_SIZE 16
+
+// A straight move between two step positions with a trapezoidal velocity
+// profile. Speeds are measured along the path, rates are in step events
+// (steps of the axis that moves the most) per second.
+struct PlannerBlock
+{
+    int32_t target[2];
+    int32_t steps[2];
+    uint32_t stepEventCount;
+
+    float length;
+    float unit[2];
+    float nominalSpeed;
+    // highest speed it can start or end at standing still
+    float stopSpeed;
+    float maxEntrySpeed;
+    float entrySpeed;
+
+    float initialRate, nominalRate, finalRate;
+    float accelerationRate;
+    // the last block queued, it ends standing still
+    bool stops;
+};
+
+class Planner
+{
+public:
+    Planner();
+
+    void setAcceleration(float acceleration) { this->acceleration = acceleration; }
+    void setJunctionDeviation(float deviation) { junctionDeviation = deviation; }
+    // steps/s an axis starts and stops at without ramping
+    void setStartSpeed(float speed) { startSpeed = speed; }
+    void setPosition(int32_t x, int32_t y);
+    // where the queued moves end
+    int32_t getPosition(uint8_t axis) const { return position[axis]; }
+    void clear();
+
+    bool isEmpty() const { return head == tail; }
+    bool isFull() const { return next(head) == tail; }
+
+    // queues a move to x, y; speed is given for the axis that moves the most
+    // (same as MultiStepper max speed) and is converted to a path speed.
+    // returns false if the queue is full
+    bool push(int32_t x, int32_t y, float speed);
+
+    // the oldest block; its entry speed is final and it is safe to execute
+    const PlannerBlock *current() const { return isEmpty() ? nullptr : &blocks[tail]; }
+    void discardCurrent();
+
+    // step rate to use for the step with the given index (0 based)
+    static float rateAt(const PlannerBlock &block, uint32_t step);
+    // seconds the block takes to run
+    static float duration(const PlannerBlock &block);
+
+private:
+    static uint8_t next(uint8_t index) { return (index + 1) % PLANNER_BUFFER_SIZE; }
+    static uint8_t prev(uint8_t index) { return (index + PLANNER_BUFFER_SIZE - 1) % PLANNER_BUFFER_SIZE; }
+
+    float maxSpeedFrom(float speed, float distance) const;
+    void recalculate();
+    void calculateTrapezoid(PlannerBlock &block, float exitSpeed, bool stops);
+
+    PlannerBlock blocks[PLANNER_BUFFER_SIZE];
+    uint8_t head, tail;
+
+    int32_t position[2];
+    float previousUnit[2];
+    float previousNominalSpeed;
+    float previousStopSpeed;
+
+    float acceleration;
+    float junctionDeviation;
+    float startSpeed;
+};
+
+#endif
@@ -1,33 +1,126 @@
 #include "esp32-hal-ledc.h"
+#include "esp32-hal-timer.h"
 #include "printer.h"
+#include "eggbin.h"
+#include "fsstream.h"
 
 #define TASK_PRIORITY 2
+#define READ_TASK_PRIORITY 1
+#define PEN_TASK_PRIORITY 1
+#define STEP_TIMER 0
+
+// shared with the step interrupt
+static StepQueue stepQueue;
+static StepTicker stepTicker;
+static hw_timer_t *stepTimer = NULL;
+static volatile uint8_t stepDirInvert = 0;
 
 void printTaskHandler(void *arg)
 {
     ((Printer *)arg)->printTask();
 }
 
-Printer::Printer()
-    : mRotation(AccelStepper::DRIVER, PIN_ROT_STEP, PIN_ROT_DIR),
-      mPen(AccelStepper::DRIVER, PIN_PEN_STEP, PIN_PEN_DIR)
+void readTaskHandler(void *arg)
 {
-    mRotation.setEnablePin(PIN_ROT_RES);
-    mPen.setEnablePin(PIN_PEN_RES);
-    mRotation.setAcceleration(.1);
-    mPen.setAcceleration(.1);
+    ((Printer *)arg)->readTask();
+}
 
-    multiStepper.addStepper(mRotation);
-    multiStepper.addStepper(mPen);
+void penTaskHandler(void *arg)
+{
+    ((Printer *)arg)->penTask();
+}
+
+// the motion parameters as saved, with the version of their layout
+struct SavedParameters
+{
+    uint8_t version;
+    MotionParameters params;
+};
+
+// the job file, its reads timed
+class TimedFileSource : public FileSource
+{
+public:
+    TimedFileSource(File &file, Histogram &reads, const PrintMetrics &metrics)
+        : FileSource(file), reads(reads), metrics(metrics) {}
+
+    size_t read(uint8_t *buffer, size_t length) override
+    {
+        uint32_t start = metrics.now();
+        size_t read = FileSource::read(buffer, length);
+        reads.add(metrics.since(start));
+        return read;
+    }
+
+private:
+    Histogram &reads;
+    const PrintMetrics &metrics;
+};
+
+void IRAM_ATTR stepTimerHandler()
+{
+    uint8_t bits;
+    timerAlarmWrite(stepTimer, stepTicker.tick(stepQueue, bits), true);
+    if (!(bits & (STEP_ROTATION | STEP_PEN)))
+    {
+        return;
+    }
+
+    static uint8_t lastDir = 0xFF;
+    uint8_t dir = (bits ^ stepDirInvert) & (DIR_ROTATION | DIR_PEN);
+    if (dir != lastDir)
+    {
+        lastDir = dir;
+        digitalWrite(PIN_ROT_DIR, dir & DIR_ROTATION ? HIGH : LOW);
+        digitalWrite(PIN_PEN_DIR, dir & DIR_PEN ? HIGH : LOW);
+        // direction setup time
+        delayMicroseconds(1);
+    }
+
+    if (bits & STEP_ROTATION)
+    {
+        digitalWrite(PIN_ROT_STEP, HIGH);
+    }
+    if (bits & STEP_PEN)
+    {
+        digitalWrite(PIN_PEN_STEP, HIGH);
+    }
+    // minimum step pulse width
+    delayMicroseconds(2);
+    digitalWrite(PIN_ROT_STEP, LOW);
+    digitalWrite(PIN_PEN_STEP, LOW);
+}
+
+Printer::Printer()
+    : waiting(false), printing(NULL), source(NULL), inflater(NULL), blockReader(NULL), reader(NULL), stream(NULL),
+      confirmStart(false), confirmingStart(false), completedPrints(0), feedOverride(100),
+      motionEndsAt(0), _isPenUp(true), stopping(false), inFileWork(false)
+{
 }
 
 void Printer::begin()
 {
+    // the pen waits are timed from here on
+    metrics.reset();
+    pinMode(PIN_ROT_STEP, OUTPUT);
+    pinMode(PIN_ROT_DIR, OUTPUT);
+    pinMode(PIN_ROT_RES, OUTPUT);
+    pinMode(PIN_PEN_STEP, OUTPUT);
+    pinMode(PIN_PEN_DIR, OUTPUT);
+    pinMode(PIN_PEN_RES, OUTPUT);
     disableMotors();
+
+    stepTimer = timerBegin(STEP_TIMER, 80, true);
+    timerAttachInterrupt(stepTimer, &stepTimerHandler, true);
+    timerAlarmWrite(stepTimer, STEP_IDLE_INTERVAL, true);
+    timerAlarmEnable(stepTimer);
+
     ledcSetup(SERVO_CHA, 50, 16);
     ledcAttachPin(PIN_SERVO, SERVO_CHA);
+    xTaskCreatePinnedToCore(penTaskHandler, "Pen", 2000, this, PEN_TASK_PRIORITY, &penTaskHandle, 0);
 
     preferences.begin("motion");
+    checkpoints.begin("checkpoint");
     getParameters(parameters);
     applyParameters();
 
@@ -44,24 +137,61 @@ void Printer::stop()
 
     waiting = false;
     printedLines = 0;
+    estimatedSeconds = elapsedSeconds = 0;
+    reportedPercent = 0;
     waitingFor = String();
     printTaskHandle = NULL;
-    onStatus();
+    printerEvents.pushStatus();
 
     if (xTaskGetCurrentTaskHandle() != handle)
     {
         //if we stop from outside the print task,
         //stop first, close file 2nd
+        stopping = true;
+        while (inFileWork)
+        {
+            delay(1);
+        }
         vTaskDelete(handle);
         handle = NULL;
     }
 
+    // the print task is gone, drop whatever steps it left queued
+    stepTicker.requestFlush();
+    while (stepTicker.isFlushPending())
+    {
+        delay(1);
+    }
+
     if (printing)
     {
+        // let the read task finish its current SD read and exit
+        blockReader->abort();
+        while (readTaskHandle)
+        {
+            delay(1);
+        }
+
+        delete reader;
+        delete blockReader;
+        delete inflater;
+        delete source;
+        reader = NULL;
+        blockReader = NULL;
+        inflater = NULL;
+        source = NULL;
+
         printing->close();
         delete printing;
         printing = NULL;
     }
+    if (stream)
+    {
+        stream->abort();
+        delete reader;
+        reader = NULL;
+        stream = NULL;
+    }
 
     disableMotors();
     penUp();
@@ -72,94 +202,547 @@ void Printer::stop()
     }
 }
 
-void Printer::print(fs::File file)
+void Printer::print(fs::File file, uint32_t line, bool confirm, float seconds)
+{
+    stop();
+    if (!line)
+    {
+        clearCheckpoint();
+    }
+    start.line = line;
+    startMarked = false;
+    confirmStart = confirm;
+    knownSeconds = seconds;
+    startPrint(file);
+}
+
+void Printer::resume(fs::File file, const PrintCheckpoint &checkpoint)
 {
     stop();
+    start = checkpoint;
+    startMarked = true;
+    confirmStart = false;
+    knownSeconds = 0;
+    startPrint(file);
+}
 
+void Printer::printStream(StreamBuffer &stream, const char *name)
+{
+    stop();
+    start.line = 0;
+    startMarked = false;
+    confirmStart = false;
+    this->stream = &stream;
+    streamName = String(name);
+    metrics.reset();
+    startTask();
+}
+
+void Printer::startPrint(fs::File file)
+{
     printing = new File(file);
-    mPen.setCurrentPosition(0);
-    mRotation.setCurrentPosition(0);
+    metrics.reset();
+    source = new TimedFileSource(*printing, metrics.read, metrics);
+
+    uint8_t header[EGGBIN_HEADER_SIZE];
+    size_t length = printing->read(header, sizeof(header));
+    binaryJob = length == sizeof(header) && isEggBinaryHeader(header, sizeof(header));
+    // a compressed job is text, inflated by the read task as it goes
+    compressedJob = isGzipHeader(header, length);
+    printing->seek(0);
+
+    inflater = compressedJob ? new GzipSource(*source) : NULL;
+    blockReader = new BlockReader(compressedJob ? *inflater : *source, []() { vTaskDelay(1); });
+    if (!blockReader->begin())
+    {
+        delete blockReader;
+        delete inflater;
+        delete source;
+        blockReader = NULL;
+        inflater = NULL;
+        source = NULL;
+        printing->close();
+        delete printing;
+        printing = NULL;
+        return;
+    }
+    startTask();
+}
+
+void Printer::startTask()
+{
+    estimatedSeconds = elapsedSeconds = 0;
+    reportedPercent = 0;
+
+    stepTicker.setPosition(0, 0);
+    planner.setPosition(0, 0);
+    wrap.begin(parameters.stepsPerRotation);
+    stopping = false;
     xTaskCreatePinnedToCore(printTaskHandler, "Print", 8000, this, TASK_PRIORITY, &printTaskHandle, 0);
 }
 
-void Printer::printTask()
+JobReader *Printer::createReader(ByteSource &source, const JobMark *from)
 {
-    uint32_t lastProgress = 0;
-    while (printing->available())
+    JobReader *created;
+    if (binaryJob)
     {
-        char buffer[31];
-        auto read = printing->readBytesUntil('\n', buffer, 30);
-        printedLines++;
-        if (!read)
+        auto binaryReader = new BinaryJobReader(source, parameters.stepsPerRotation);
+        if (!from)
         {
-            continue;
+            binaryReader->begin();
         }
-        buffer[read] = 0;
+        created = binaryReader;
+    }
+    else
+    {
+        created = new TextJobReader(source, parameters.stepsPerRotation);
+    }
 
-        if (strcmp(buffer, "P0") == 0)
-        {
-            penUp();
-        }
-        else if (strcmp(buffer, "P1") == 0)
-        {
-            penDown();
-        }
-        else if (strcmp(buffer, "M1") == 0)
+    if (from)
+    {
+        created->restore(*from);
+    }
+    return created;
+}
+
+bool Printer::estimateJob()
+{
+    if (knownSeconds > 0 && !start.line)
+    {
+        // estimated at upload, the file is still at its start
+        estimatedSeconds = knownSeconds;
+        elapsedSeconds = 0;
+        return !compressedJob || inflater->begin();
+    }
+
+    JobEstimator estimator(parameters);
+    FileSource fileSource(*printing);
+    GzipSource *scanInflater = NULL;
+    if (compressedJob)
+    {
+        // inflated once for the scan and once more for the print, one
+        // window at a time
+        scanInflater = new GzipSource(fileSource);
+        if (!scanInflater->begin())
         {
-            enableMotors();
+            delete scanInflater;
+            return false;
         }
-        else if (strcmp(buffer, "M0") == 0)
+    }
+    JobReader *scan = createReader(scanInflater ? (ByteSource &)*scanInflater : fileSource, NULL);
+    Command cmd;
+    float startSeconds = 0;
+    // stop() waits for the scan, it ends at the next line
+    while (!stopping && scan->next(cmd))
+    {
+        estimator.add(cmd);
+        if (start.line && estimator.getLines() == start.line)
         {
-            disableMotors();
+            // a checkpoint already knows where the job is, a line does not
+            if (!startMarked)
+            {
+                scan->mark(start.mark);
+                start.position[0] = estimator.getPosition(0);
+                start.position[1] = estimator.getPosition(1);
+                start.penUp = estimator.isPenUp();
+                startMarked = true;
+            }
+            startSeconds = estimator.getSeconds();
         }
-        else if (buffer[0] == 'Z')
+    }
+    delete scan;
+    delete scanInflater;
+    estimatedSeconds = estimator.end();
+    elapsedSeconds = startSeconds;
+
+    uint32_t offset = start.line ? start.mark.offset : 0;
+    if (compressedJob)
+    {
+        // the mark is in the inflated job, there is no seeking to it
+        printing->seek(0);
+        return inflater->begin() && inflater->skip(offset);
+    }
+    printing->seek(offset);
+    return true;
+}
+
+void Printer::moveToStart()
+{
+    // travel to where the skipped lines left the job, with the pen up
+    float seconds = elapsedSeconds;
+    printedLines = start.line;
+    enableMotors();
+    penUp();
+    moveTo(wrap.map(start.position[0], 0, true), start.position[1]);
+    finishMoves();
+    if (!start.penUp)
+    {
+        penDown();
+    }
+    elapsedSeconds = seconds;
+}
+
+bool Printer::getCheckpoint(PrintCheckpoint &checkpoint)
+{
+    auto size = sizeof(PrintCheckpoint);
+    return checkpoints.getBytes("*", &checkpoint, size) == size &&
+           checkpoint.stepsPerRotation == parameters.stepsPerRotation;
+}
+
+void Printer::clearCheckpoint()
+{
+    checkpoints.remove("*");
+}
+
+void Printer::saveCheckpoint()
+{
+    // only called with all motion done, so the step positions belong to the
+    // last line read; a stream cannot be resumed
+    uint32_t now = millis();
+    if (stream || now - lastCheckpoint < CHECKPOINT_INTERVAL)
+    {
+        return;
+    }
+    lastCheckpoint = now;
+
+    PrintCheckpoint checkpoint;
+    strlcpy(checkpoint.path, printing->name(), sizeof(checkpoint.path));
+    checkpoint.line = printedLines;
+    reader->mark(checkpoint.mark);
+    checkpoint.position[0] = wrap.unmap(stepTicker.position(0));
+    checkpoint.position[1] = stepTicker.position(1);
+    checkpoint.penUp = _isPenUp;
+    checkpoint.stepsPerRotation = parameters.stepsPerRotation;
+    beginFileWork();
+    checkpoints.putBytes("*", &checkpoint, sizeof(PrintCheckpoint));
+    endFileWork();
+}
+
+void Printer::beginFileWork()
+{
+    inFileWork = true;
+    // stop() either sees the work begin and waits, or this sees it stopping
+    if (stopping)
+    {
+        inFileWork = false;
+        vTaskSuspend(NULL);
+    }
+}
+
+void Printer::endFileWork()
+{
+    inFileWork = false;
+    if (stopping)
+    {
+        vTaskSuspend(NULL);
+    }
+}
+
+uint8_t Printer::getProgressPercent()
+{
+    if (estimatedSeconds <= 0)
+    {
+        // no estimate, rely on the Z lines of the job
+        return reportedPercent;
+    }
+    return elapsedSeconds >= estimatedSeconds ? 100 : elapsedSeconds * 100 / estimatedSeconds;
+}
+
+uint32_t Printer::getRemainingSeconds()
+{
+    // the estimate is at the configured speeds
+    return elapsedSeconds >= estimatedSeconds ? 0 : (estimatedSeconds - elapsedSeconds) * 100 / feedOverride;
+}
+
+void Printer::readTask()
+{
+    blockReader->fill();
+    readTaskHandle = NULL;
+    vTaskDelete(NULL);
+}
+
+void Printer::printTask()
+{
+    // scan the whole job for the time estimate before the read task
+    // starts streaming it; a stream can only be read once, as it arrives
+    beginFileWork();
+    bool readable = stream || estimateJob();
+    endFileWork();
+    if (!readable || (start.line && !startMarked))
+    {
+        // unreadable, or the job is shorter than that
+        stop();
+        return;
+    }
+    notifyProgress();
+    if (confirmStart)
+    {
+        confirmingStart = true;
+        pause();
+        confirmingStart = false;
+    }
+    if (stream)
+    {
+        reader = new TextJobReader(*stream, parameters.stepsPerRotation);
+    }
+    else
+    {
+        xTaskCreatePinnedToCore(readTaskHandler, "Read", 4000, this, READ_TASK_PRIORITY, (TaskHandle_t *)&readTaskHandle, 0);
+        // a binary reader consumes its header here, so it needs the read task
+        reader = createReader(*blockReader, start.line ? &start.mark : NULL);
+    }
+    pathFilter.begin(parameters.pathTolerance, start.line ? start.position[0] : 0, start.line ? start.position[1] : 0);
+    strokeSpeed.begin(parameters.drawingSpeed, parameters.maxDrawingSpeed, parameters.straightRun,
+                      start.line ? start.position[0] : 0, start.line ? start.position[1] : 0);
+    if (start.line)
+    {
+        moveToStart();
+    }
+    lastCheckpoint = millis();
+
+    uint32_t lastProgress = 0;
+    Command cmd;
+    uint32_t parseStart = metrics.now();
+    while (reader->next(cmd))
+    {
+        metrics.parse.add(metrics.since(parseStart));
+        printedLines++;
+        execute(cmd);
+
+        uint32_t now = millis();
+        if (now - lastProgress > 1000)
         {
-            //TODO: report progress percent on LCD
-            // progress = atoi(&buffer[2]);
+            lastProgress = now;
+            notifyProgress();
+            sampleStacks();
         }
-        else if (buffer[0] == 'S')
+
+        if (planner.isEmpty() && pathFilter.isEmpty() && strokeSpeed.isEmpty())
         {
-            long lastPenPosition = mPen.currentPosition();
-            moveTo(mRotation.currentPosition(), 0);
-            waitingFor = String(&buffer[2]);
-            pause();
-            waitingFor = String();
-            moveTo(mRotation.currentPosition(), lastPenPosition);
+            vTaskDelay(1);
         }
-        else if (strcmp(buffer, "H") == 0)
+        parseStart = metrics.now();
+    }
+
+    finishMoves();
+    if (!stream)
+    {
+        beginFileWork();
+        clearCheckpoint();
+        endFileWork();
+    }
+    completedPrints++;
+    stop();
+}
+
+void Printer::notifyProgress()
+{
+    printerEvents.pushProgress(printedLines, getProgressPercent(), getRemainingSeconds());
+}
+
+void Printer::sampleStacks()
+{
+    // high water marks are the least free there has been
+    metrics.printStack = uxTaskGetStackHighWaterMark(NULL);
+    if (readTaskHandle)
+    {
+        metrics.readStack = uxTaskGetStackHighWaterMark(readTaskHandle);
+    }
+    metrics.penStack = uxTaskGetStackHighWaterMark(penTaskHandle);
+}
+
+void Printer::execute(const Command &cmd)
+{
+    if (cmd.type == CMD_MOVE)
+    {
+        pathFilter.add(cmd.x, cmd.y);
+        runFilteredMoves();
+        return;
+    }
+
+    if (cmd.type == CMD_PROGRESS)
+    {
+        reportedPercent = cmd.value;
+        return;
+    }
+
+    if (cmd.type == CMD_NONE)
+    {
+        return;
+    }
+
+    // everything else acts on the position the queued moves end up in;
+    // the pen starts down while the last of them are still going
+    if (cmd.type == CMD_PEN_DOWN)
+    {
+        runMoves();
+        waitForMotion(parameters.penOverlap);
+    }
+    else
+    {
+        finishMoves();
+    }
+
+    switch (cmd.type)
+    {
+    case CMD_PEN_UP:
+        // and the travel after a lift starts before it is done
+        if (!_isPenUp)
         {
-            moveTo(0, 0);
+            elapsedSeconds += penMoveTime(parameters, true) / 1000.0f;
         }
-        else if (buffer[0] == 'T')
+        movePen(true);
+        waitForPen(parameters.penOverlap);
+        break;
+    case CMD_PEN_DOWN:
+        if (_isPenUp)
         {
-            long x = roundf((float)atof(&buffer[2]) / 360.0f * parameters.stepsPerRotation);
-            long y = roundf((float)atof(strchr(&buffer[2], ' ')) / 360.0f * parameters.stepsPerRotation);
-            moveTo(x, y);
+            elapsedSeconds += penMoveTime(parameters, false) / 1000.0f;
         }
+        movePen(false);
+        waitForPen();
+        waitForMotion();
+        break;
+    case CMD_MOTORS_ENABLE:
+        enableMotors();
+        break;
+    case CMD_MOTORS_DISABLE:
+        disableMotors();
+        break;
+    case CMD_WAIT:
+    {
+        long lastPenPosition = stepTicker.position(1);
+        moveTo(stepTicker.position(0), 0);
+        finishMoves();
+        waitingFor = String(cmd.text);
+        pause();
+        waitingFor = String();
+        moveTo(stepTicker.position(0), lastPenPosition);
+        finishMoves();
+        break;
+    }
+    case CMD_HOME:
+        home();
+        break;
+    default:
+        break;
+    }
 
-        uint32_t now = millis();
-        if (now - lastProgress > 1000)
-        {
-            lastProgress = now;
-            if (onProgress)
-            {
-                onProgress();
-            }
-        }
+    saveCheckpoint();
+}
 
-        vTaskDelay(1);
+void Printer::moveTo(long x, long y)
+{
+    moveTo(x, y, _isPenUp ? parameters.travelSpeed : parameters.drawingSpeed);
+}
+
+void Printer::moveTo(long x, long y, float speed)
+{
+    // keep as many moves queued as possible so the planner can look ahead
+    if (planner.isFull())
+    {
+        runBlock(*planner.current());
+        planner.discardCurrent();
     }
+    uint32_t start = metrics.now();
+    planner.push(x, y, speed * feedOverride / 100);
+    metrics.plan.add(metrics.since(start));
+}
 
-    stop();
+void Printer::runFilteredMoves()
+{
+    int32_t x, y;
+    while (pathFilter.next(x, y))
+    {
+        strokeSpeed.add(x, y);
+        runStrokeMoves();
+    }
 }
 
-void Printer::moveTo(long x, long y)
+void Printer::runStrokeMoves()
+{
+    int32_t x, y;
+    float speed;
+    while (strokeSpeed.next(x, y, speed))
+    {
+        // travel takes the shorter way round the egg
+        moveTo(wrap.map(x, planner.getPosition(0), _isPenUp || parameters.wrapDrawing), y,
+               _isPenUp ? parameters.travelSpeed : speed);
+    }
+}
+
+void Printer::home()
 {
-    disableCore0WDT();
-    long pos[2] = {x, y};
-    multiStepper.moveTo(pos);
-    multiStepper.runSpeedToPosition();
-    enableCore0WDT();
+    // to the nearest whole turn, which then is the job's rotation 0 again so
+    // positions never grow past a turn or two
+    moveTo(wrap.map(0, planner.getPosition(0), true), 0);
+    finishMoves();
+    stepTicker.setPosition(0, 0);
+    planner.setPosition(0, 0);
+    wrap.reset();
+    pathFilter.setPosition(0, 0);
+    strokeSpeed.setPosition(0, 0);
+}
+
+void Printer::finishMoves()
+{
+    runMoves();
+    waitForMotion();
+}
+
+void Printer::runMoves()
+{
+    // the moves the filter and stroke speeds still hold back come first
+    pathFilter.flush();
+    runFilteredMoves();
+    strokeSpeed.flush();
+    runStrokeMoves();
+    while (!planner.isEmpty())
+    {
+        runBlock(*planner.current());
+        planner.discardCurrent();
+    }
+}
+
+void Printer::runBlock(const PlannerBlock &block)
+{
+    // the step interrupt keeps running from the queue while we wait for room
+    float duration = Planner::duration(block);
+    // kept at the configured speeds, like the estimate
+    elapsedSeconds += duration * feedOverride / 100;
+    uint32_t now = micros();
+    if ((int32_t)(motionEndsAt - now) < 0)
+    {
+        motionEndsAt = now;
+    }
+    motionEndsAt += (uint32_t)(duration * 1000000);
+    stepGenerator.load(block);
+    if (!stepGenerator.fill(stepQueue))
+    {
+        uint32_t start = metrics.now();
+        do
+        {
+            vTaskDelay(1);
+        } while (!stepGenerator.fill(stepQueue));
+        metrics.motionWait.add(metrics.since(start));
+    }
+}
+
+void Printer::waitForMotion(uint32_t early)
+{
+    // early goes by the modelled end, all of it by the steps themselves
+    uint32_t start = metrics.now();
+    bool waited = false;
+    while ((!stepQueue.isEmpty() || !stepTicker.isIdle()) &&
+           (!early || (int32_t)(motionEndsAt - micros()) > (int32_t)(early * 1000)))
+    {
+        waited = true;
+        vTaskDelay(1);
+    }
+    if (waited)
+    {
+        metrics.motionWait.add(metrics.since(start));
+    }
 }
 
 void Printer::pause()
@@ -167,7 +750,7 @@ void Printer::pause()
     if (printTaskHandle && !waiting)
     {
         waiting = true;
-        onStatus();
+        printerEvents.pushStatus();
         vTaskSuspend(printTaskHandle);
     }
 }
@@ -178,81 +761,154 @@ void Printer::continuePrint()
     {
         vTaskResume(printTaskHandle);
         waiting = false;
-        onStatus();
+        printerEvents.pushStatus();
     }
 }
 
 void Printer::penUp()
 {
-    _isPenUp = true;
-    ledcWrite(SERVO_CHA, penUpValue);
-    delay(parameters.penMoveDelay);
-    mRotation.setMaxSpeed(parameters.travelSpeed);
-    mPen.setMaxSpeed(parameters.travelSpeed);
+    movePen(true);
+    waitForPen();
 }
 
 void Printer::penDown()
 {
-    _isPenUp = false;
-    ledcWrite(SERVO_CHA, penDownValue);
-    delay(parameters.penMoveDelay);
-    mRotation.setMaxSpeed(parameters.drawingSpeed);
-    mPen.setMaxSpeed(parameters.drawingSpeed);
+    movePen(false);
+    waitForPen();
+}
+
+void Printer::movePen(bool up)
+{
+    _isPenUp = up;
+    penRamp.move(up, millis());
+    xTaskNotifyGive(penTaskHandle);
+}
+
+void Printer::waitForPen(uint32_t early)
+{
+    if (penRamp.remaining(millis()) <= early)
+    {
+        return;
+    }
+    uint32_t start = metrics.now();
+    do
+    {
+        delay(1);
+    } while (penRamp.remaining(millis()) > early);
+    metrics.penWait.add(metrics.since(start));
+}
+
+void Printer::penTask()
+{
+    // the servo gets each step of a ramp, the last one when it is due
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint32_t remaining;
+        do
+        {
+            uint32_t now = millis();
+            ledcWrite(SERVO_CHA, penRamp.dutyAt(now));
+            remaining = penRamp.remaining(now);
+            if (remaining)
+            {
+                vTaskDelay((remaining < PEN_RAMP_INTERVAL ? remaining : PEN_RAMP_INTERVAL) / portTICK_PERIOD_MS);
+            }
+        } while (remaining);
+    }
+}
+
+void Printer::samplePosition(MachinePosition &position)
+{
+    uint16_t turn = parameters.stepsPerRotation;
+    stepTicker.snapshot(position.x, position.y);
+    if (turn)
+    {
+        position.x %= turn;
+        position.x += position.x < 0 ? turn : 0;
+    }
+    position.stepsPerRotation = turn;
+    position.penHeight = penRamp.heightAt(millis());
+    position.moving = !stepTicker.isIdle();
 }
 
 void Printer::getParameters(MotionParameters &params)
 {
-    auto size = sizeof(MotionParameters);
-    if (preferences.getBytes("*", &params, size) != size)
+    getDefaultParameters(params);
+
+    SavedParameters saved;
+    size_t size = preferences.getBytes("*", &saved, sizeof(SavedParameters));
+    if (size == sizeof(SavedParameters) && saved.version == MOTION_PARAMETERS_VERSION)
     {
-        params.penDownPercent = 70;
-        params.penUpPercent = 40;
-        params.drawingSpeed = 500;
-        params.travelSpeed = 2000;
-        params.penMoveDelay = 150;
-        params.stepsPerRotation = 6400;
-        params.reversePen = false;
-        params.reverseRotation = false;
+        params = saved.params;
+    }
+    else if (size == sizeof(MotionParametersV0))
+    {
+        // keep the calibration, whatever was added since gets its default
+        MotionParametersV0 old;
+        preferences.getBytes("*", &old, sizeof(MotionParametersV0));
+        params.penUpPercent = old.penUpPercent;
+        params.penDownPercent = old.penDownPercent;
+        params.drawingSpeed = old.drawingSpeed;
+        params.travelSpeed = old.travelSpeed;
+        params.penUpDelay = params.penDownDelay = old.penMoveDelay;
+        params.stepsPerRotation = old.stepsPerRotation;
+        params.reverseRotation = old.reverseRotation;
+        params.reversePen = old.reversePen;
     }
 }
 
 void Printer::setParameters(const MotionParameters &params)
 {
     parameters = params;
-    preferences.putBytes("*", &parameters, sizeof(MotionParameters));
+    SavedParameters saved;
+    saved.version = MOTION_PARAMETERS_VERSION;
+    saved.params = params;
+    preferences.putBytes("*", &saved, sizeof(SavedParameters));
     applyParameters();
 }
 
+void Printer::setFeedOverride(int32_t percent)
+{
+    percent = percent < FEED_OVERRIDE_MIN ? FEED_OVERRIDE_MIN : percent > FEED_OVERRIDE_MAX ? FEED_OVERRIDE_MAX : percent;
+    if (percent != feedOverride)
+    {
+        feedOverride = percent;
+        printerEvents.pushStatus();
+    }
+}
+
 void Printer::applyParameters()
 {
     penUpValue = SERVO_MIN + (SERVO_MAX - SERVO_MIN) * parameters.penUpPercent / 100;
     penDownValue = SERVO_MIN + (SERVO_MAX - SERVO_MIN) * parameters.penDownPercent / 100;
+    penRamp.setTimings(penUpValue, penDownValue, parameters.penUpDelay, parameters.penDownDelay);
 
     if (_isPenUp)
     {
         penUp();
-        mRotation.setMaxSpeed(parameters.travelSpeed);
-        mPen.setMaxSpeed(parameters.travelSpeed);
     }
     else
     {
         penDown();
-        mRotation.setMaxSpeed(parameters.drawingSpeed);
-        mPen.setMaxSpeed(parameters.drawingSpeed);
     }
 
-    mRotation.setPinsInverted(parameters.reverseRotation);
-    mPen.setPinsInverted(parameters.reversePen);
+    planner.setAcceleration(parameters.acceleration);
+    planner.setJunctionDeviation(parameters.junctionDeviation);
+    planner.setStartSpeed(parameters.startSpeed);
+
+    stepDirInvert = (parameters.reverseRotation ? DIR_ROTATION : 0) |
+                    (parameters.reversePen ? DIR_PEN : 0);
 }
 
 void Printer::enableMotors()
 {
-    mRotation.enableOutputs();
-    mPen.enableOutputs();
+    digitalWrite(PIN_ROT_RES, HIGH);
+    digitalWrite(PIN_PEN_RES, HIGH);
 }
 
 void Printer::disableMotors()
 {
-    mRotation.disableOutputs();
-    mPen.disableOutputs();
+    digitalWrite(PIN_ROT_RES, LOW);
+    digitalWrite(PIN_PEN_RES, LOW);
 }
@@ -1,12 +1,25 @@
 #ifndef PRINTER_H
 #define PRINTER_H
 
-#include <AccelStepper.h>
-#include <MultiStepper.h>
 #include <Preferences.h>
 #include <FS.h>
-
-typedef std::function<void()> PrinterHandler;
+#include <atomic>
+
+#include "blockreader.h"
+#include "command.h"
+#include "estimator.h"
+#include "events.h"
+#include "gzipsource.h"
+#include "jobreader.h"
+#include "metrics.h"
+#include "motionparams.h"
+#include "pathfilter.h"
+#include "penramp.h"
+#include "planner.h"
+#include "stepgen.h"
+#include "streambuffer.h"
+#include "strokespeed.h"
+#include "wrap.h"
 
 #define PIN_ROT_DIR 2
 #define PIN_ROT_STEP 17
@@ -21,13 +34,40 @@ typedef std::function<void()> PrinterHandler;
 #define SERVO_MIN (65536 / 20)
 #define SERVO_MAX (2 * SERVO_MIN)
 
-struct MotionParameters
+// the pen servo follows its ramp in steps this long, ms (its PWM period)
+#define PEN_RAMP_INTERVAL 20
+
+// feed rate override, percent of the configured speeds
+#define FEED_OVERRIDE_MIN 10
+#define FEED_OVERRIDE_MAX 300
+// a press of the M5 buttons
+#define FEED_OVERRIDE_STEP 10
+
+// minimum time between two checkpoints, they are written to flash
+#define CHECKPOINT_INTERVAL 15000
+
+// where an interrupted print can continue from, saved while printing
+struct PrintCheckpoint
+{
+    char path[64];
+    // lines done
+    uint32_t line;
+    JobMark mark;
+    // in the job, the machine may be whole turns away
+    int32_t position[2];
+    bool penUp;
+    uint16_t stepsPerRotation;
+};
+
+// where the machine is at one moment, for showing it live
+struct MachinePosition
 {
-    uint8_t penUpPercent, penDownPercent;
-    uint16_t drawingSpeed, travelSpeed;
-    uint16_t penMoveDelay;
+    // steps, the rotation within one turn (the job's up to whole turns)
+    int32_t x, y;
     uint16_t stepsPerRotation;
-    bool reverseRotation, reversePen;
+    // 0 down to 255 up, in between while the servo moves
+    uint8_t penHeight;
+    bool moving;
 };
 
 class Printer
@@ -36,48 +76,144 @@ public:
     Printer();
     void begin();
 
+    // move the pen and wait until it is there
     void penUp();
     void penDown();
     void enableMotors();
     void disableMotors();
     void getParameters(MotionParameters &params);
     void setParameters(const MotionParameters &params);
-
-    void print(File file);
+    // scales the speed of the moves queued from now on; not saved, and the
+    // pen is left alone
+    void setFeedOverride(int32_t percent);
+    uint16_t getFeedOverride() { return feedOverride; }
+
+    // starts after the first line lines of the job; the machine is expected
+    // at home, it travels to where the job is at that line. With confirm it
+    // first waits for continuePrint, like an S line (e.g. for the next egg).
+    // A known estimate in seconds saves reading the whole job for it first
+    // (from the start only, 0 reads it)
+    void print(File file, uint32_t line = 0, bool confirm = false, float seconds = 0);
+    void resume(File file, const PrintCheckpoint &checkpoint);
+    // a text job read as it arrives: no estimate and no checkpoints, the
+    // progress is what its Z lines say
+    void printStream(StreamBuffer &stream, const char *name);
+    // false if there is no checkpoint usable with the current parameters
+    bool getCheckpoint(PrintCheckpoint &checkpoint);
+    void clearCheckpoint();
     void stop();
     void pause();
     void continuePrint();
 
     bool isPaused() { return waiting; }
-    String getWaitingFor() { return waitingFor; }
+    // paused before the first move, for the operator to confirm the start
+    bool isConfirmingStart() { return waiting && confirmingStart; }
+    // prints that ran to their end
+    uint32_t getCompletedPrints() { return completedPrints; }
+    const String &getWaitingFor() { return waitingFor; }
     bool isPrinting() { return printTaskHandle ? true : false; }
+    bool isStreaming() { return stream ? true : false; }
     const ulong getPrintedLines() { return printedLines; }
-    const char *printingFileName() { return printing->name(); }
-
-    void onProgressChanged(PrinterHandler handler) { onProgress = handler; }
-    void onStatusChanged(PrinterHandler handler) { onStatus = handler; }
+    uint8_t getProgressPercent();
+    uint32_t getEstimatedSeconds() { return estimatedSeconds; }
+    uint32_t getRemainingSeconds();
+    size_t getReadAhead() { return stream ? stream->getBuffered() : blockReader ? blockReader->getReadAhead() : 0; }
+    uint32_t getReadStalls() { return stream ? stream->getStalls() : blockReader ? blockReader->getStalls() : 0; }
+    // moves of the job left out by the path filter
+    uint32_t getMergedMoves() { return pathFilter.getMerged(); }
+    uint32_t getSimplifiedMoves() { return pathFilter.getSimplified(); }
+    // of the current or last print
+    const PrintMetrics &getMetrics() { return metrics; }
+    const char *printingFileName() { return stream ? streamName.c_str() : printing->name(); }
+    // from any task, without holding up the motion
+    void samplePosition(MachinePosition &position);
+
+    // progress and status changes, consumed by the web layer on the other core
+    PrinterEvents &events() { return printerEvents; }
 
     void printTask();
+    void readTask();
+    void penTask();
 
 private:
     void applyParameters();
+    void startPrint(File file);
+    void startTask();
+    JobReader *createReader(ByteSource &source, const JobMark *from);
+    // false if a compressed job cannot be read
+    bool estimateJob();
+    void moveToStart();
+    void saveCheckpoint();
+    // around NVS and SD card work on the print task: stop() waits for it
+    // rather than delete the task holding their locks. Once stopping, the
+    // task waits to be deleted instead of going on
+    void beginFileWork();
+    void endFileWork();
+    void execute(const Command &cmd);
+    // at the configured speed for the pen
     void moveTo(long x, long y);
+    void moveTo(long x, long y, float speed);
+    void runFilteredMoves();
+    void runStrokeMoves();
+    void home();
+    void finishMoves();
+    void runMoves();
+    void runBlock(const PlannerBlock &block);
+    void notifyProgress();
+    void sampleStacks();
+    // until at most early ms of motion or of the pen move are left
+    void waitForMotion(uint32_t early = 0);
+    void movePen(bool up);
+    void waitForPen(uint32_t early = 0);
 
     bool waiting;
     File *printing;
+    ByteSource *source;
+    // between the file and the block reader for a .egg.gz job
+    GzipSource *inflater;
+    BlockReader *blockReader;
+    JobReader *reader;
+    StreamBuffer *stream;
+    String streamName;
 
     ulong printedLines;
-    PrinterHandler onProgress, onStatus;
+    bool binaryJob, compressedJob;
+    // modelled seconds of the whole job and of what has been sent to the motors
+    float estimatedSeconds, elapsedSeconds;
+    // given to print(), 0 if unknown
+    float knownSeconds;
+    uint8_t reportedPercent;
+    // where printTask starts; start.line is 0 for a whole print
+    PrintCheckpoint start;
+    bool startMarked;
+    bool confirmStart, confirmingStart;
+    volatile uint32_t completedPrints;
+    volatile uint16_t feedOverride;
+    uint32_t lastCheckpoint;
+    PrintMetrics metrics;
+    PrinterEvents printerEvents;
     String waitingFor;
-    AccelStepper mRotation, mPen;
-    MultiStepper multiStepper;
+    PathFilter pathFilter;
+    StrokeSpeed strokeSpeed;
+    Planner planner;
+    StepGenerator stepGenerator;
+    RotationWrap wrap;
+    PenRamp penRamp;
+    // when the step queue runs out, as modelled, us
+    uint32_t motionEndsAt;
 
     int32_t posX, posY;
     uint16_t penUpValue, penDownValue;
     bool _isPenUp, _isMoving;
     Preferences preferences;
+    Preferences checkpoints;
     MotionParameters parameters;
     TaskHandle_t printTaskHandle = NULL;
+    // set by stop() from another task
+    std::atomic<bool> stopping;
+    std::atomic<bool> inFileWork;
+    volatile TaskHandle_t readTaskHandle = NULL;
+    TaskHandle_t penTaskHandle = NULL;
 };
 
 #endif
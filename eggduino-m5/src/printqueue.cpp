@@ -0,0 +1,109 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "printqueue.h"
+
+PrintQueue::PrintQueue() : running(false)
+{
+    stored.count = 0;
+    stored.confirm = false;
+}
+
+void PrintQueue::begin()
+{
+    preferences.begin("queue");
+    if (preferences.getBytes("*", &stored, sizeof(Stored)) != sizeof(Stored) ||
+        stored.count > PRINT_QUEUE_SIZE)
+    {
+        stored.count = 0;
+        stored.confirm = false;
+    }
+}
+
+bool PrintQueue::add(const char *name, uint16_t copies)
+{
+    if (stored.count == PRINT_QUEUE_SIZE || !copies || strlen(name) >= PRINT_QUEUE_NAME_LENGTH)
+    {
+        return false;
+    }
+    PrintQueueEntry &entry = stored.entries[stored.count++];
+    strlcpy(entry.name, name, sizeof(entry.name));
+    entry.copies = copies;
+    entry.printed = 0;
+    save();
+    return true;
+}
+
+bool PrintQueue::remove(uint8_t index)
+{
+    if (index >= stored.count)
+    {
+        return false;
+    }
+    memmove(&stored.entries[index], &stored.entries[index + 1],
+            (stored.count - index - 1) * sizeof(PrintQueueEntry));
+    stored.count--;
+    save();
+    return true;
+}
+
+bool PrintQueue::move(uint8_t index, uint8_t position)
+{
+    if (index >= stored.count || position >= stored.count)
+    {
+        return false;
+    }
+    PrintQueueEntry entry = stored.entries[index];
+    if (position < index)
+    {
+        memmove(&stored.entries[position + 1], &stored.entries[position],
+                (index - position) * sizeof(PrintQueueEntry));
+    }
+    else
+    {
+        memmove(&stored.entries[index], &stored.entries[index + 1],
+                (position - index) * sizeof(PrintQueueEntry));
+    }
+    stored.entries[position] = entry;
+    save();
+    return true;
+}
+
+bool PrintQueue::setCopies(uint8_t index, uint16_t copies)
+{
+    // at least one more than already printed
+    if (index >= stored.count || copies <= stored.entries[index].printed)
+    {
+        return false;
+    }
+    stored.entries[index].copies = copies;
+    save();
+    return true;
+}
+
+void PrintQueue::printed()
+{
+    if (!stored.count)
+    {
+        return;
+    }
+    if (++stored.entries[0].printed >= stored.entries[0].copies)
+    {
+        remove(0);
+    }
+    else
+    {
+        save();
+    }
+}
+
+void PrintQueue::setConfirmsEachEgg(bool confirm)
+{
+    stored.confirm = confirm;
+    save();
+}
+
+void PrintQueue::save()
+{
+    preferences.putBytes("*", &stored, sizeof(Stored));
+}
@@ -0,0 +1,59 @@
+#ifndef PRINTQUEUE_H
+#define PRINTQUEUE_H
+
+#include <Preferences.h>
+#include <stdint.h>
+
+#define PRINT_QUEUE_SIZE 16
+#define PRINT_QUEUE_NAME_LENGTH 48
+
+struct PrintQueueEntry
+{
+    // the job's name, as in the file list
+    char name[PRINT_QUEUE_NAME_LENGTH];
+    uint16_t copies, printed;
+};
+
+// Jobs to print one after the other, each as many times as asked. Kept in
+// flash with every change, so it outlives a reboot; running does not, the
+// queue only starts moving the machine when asked to.
+class PrintQueue
+{
+public:
+    PrintQueue();
+    void begin();
+
+    uint8_t size() const { return stored.count; }
+    const PrintQueueEntry &at(uint8_t index) const { return stored.entries[index]; }
+
+    // false if the queue is full or the name too long
+    bool add(const char *name, uint16_t copies);
+    bool remove(uint8_t index);
+    // to position, shifting the entries in between
+    bool move(uint8_t index, uint8_t position);
+    bool setCopies(uint8_t index, uint16_t copies);
+    // a copy of the first entry is done; it leaves the queue after its last
+    void printed();
+
+    bool isRunning() const { return running; }
+    void setRunning(bool running) { this->running = running; }
+    // the operator confirms (a button press) before each egg after the first
+    bool confirmsEachEgg() const { return stored.confirm; }
+    void setConfirmsEachEgg(bool confirm);
+
+private:
+    void save();
+
+    struct Stored
+    {
+        uint8_t count;
+        bool confirm;
+        PrintQueueEntry entries[PRINT_QUEUE_SIZE];
+    };
+
+    Preferences preferences;
+    Stored stored;
+    bool running;
+};
+
+#endif
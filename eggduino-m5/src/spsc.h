@@ -0,0 +1,73 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stdint.h>
+#include <atomic>
+
+// always inlined so the consumer side can be used from IRAM interrupt handlers
+#define SPSC_INLINE inline __attribute__((always_inline))
+
+// Lock-free queue for exactly one producer and one consumer (task/task or
+// task/interrupt). Size must be a power of two; one slot is kept free.
+template <typename T, uint16_t Size>
+class SpscQueue
+{
+    static_assert((Size & (Size - 1)) == 0, "Size must be a power of two");
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    SPSC_INLINE bool push(const T &item)
+    {
+        uint16_t h = head.load(std::memory_order_relaxed);
+        uint16_t next = (h + 1) & (Size - 1);
+        if (next == tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        items[h] = item;
+        head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    SPSC_INLINE bool pop(T &item)
+    {
+        uint16_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = items[t];
+        tail.store((t + 1) & (Size - 1), std::memory_order_release);
+        return true;
+    }
+
+    // consumer side only
+    SPSC_INLINE void discardAll()
+    {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    SPSC_INLINE bool isEmpty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    SPSC_INLINE bool isFull() const
+    {
+        return ((head.load(std::memory_order_acquire) + 1) & (Size - 1)) == tail.load(std::memory_order_acquire);
+    }
+
+    SPSC_INLINE uint16_t count() const
+    {
+        return (head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) & (Size - 1);
+    }
+
+    static constexpr uint16_t capacity() { return Size - 1; }
+
+private:
+    T items[Size];
+    std::atomic<uint16_t> head, tail;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#include <stdlib.h>
+#include "stepgen.h"
+
+void StepGenerator::load(const PlannerBlock &block)
+{
+    this->block = block;
+    step = 0;
+    dirBits = 0;
+    for (uint8_t axis = 0; axis < 2; axis++)
+    {
+        absSteps[axis] = labs(block.steps[axis]);
+        counter[axis] = -(int32_t)(block.stepEventCount >> 1);
+    }
+    if (block.steps[0] > 0)
+    {
+        dirBits |= DIR_ROTATION;
+    }
+    if (block.steps[1] > 0)
+    {
+        dirBits |= DIR_PEN;
+    }
+}
+
+bool StepGenerator::fill(StepQueue &queue)
+{
+    while (step < block.stepEventCount)
+    {
+        if (queue.isFull())
+        {
+            return false;
+        }
+
+        StepEvent event;
+        event.bits = dirBits;
+        counter[0] += absSteps[0];
+        if (counter[0] > 0)
+        {
+            counter[0] -= block.stepEventCount;
+            event.bits |= STEP_ROTATION;
+        }
+        counter[1] += absSteps[1];
+        if (counter[1] > 0)
+        {
+            counter[1] -= block.stepEventCount;
+            event.bits |= STEP_PEN;
+        }
+
+        float rate = Planner::rateAt(block, step);
+        event.interval = rate > 1000000.0f / STEP_MIN_INTERVAL ? STEP_MIN_INTERVAL : (uint32_t)(1000000.0f / rate);
+
+        step++;
+        if (step == block.stepEventCount && block.stops)
+        {
+            event.bits |= STEP_STOP;
+        }
+        queue.push(event);
+    }
+    return true;
+}
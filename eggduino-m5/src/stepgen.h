@@ -0,0 +1,156 @@
+#ifndef STEPGEN_H
+#define STEPGEN_H
+
+#include <stdint.h>
+#include <atomic>
+
+#include "planner.h"
+#include "spsc.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#define STEP_ISR_ATTR IRAM_ATTR
+#else
+#define STEP_ISR_ATTR
+#endif
+
+#define STEP_QUEUE_SIZE 256
+
+// timer runs at 1MHz, intervals are in microseconds
+#define STEP_MIN_INTERVAL 50
+#define STEP_IDLE_INTERVAL 1000
+
+#define STEP_ROTATION 0x01
+#define DIR_ROTATION 0x02
+#define STEP_PEN 0x04
+#define DIR_PEN 0x08
+// last step of a block that ends standing still
+#define STEP_STOP 0x10
+
+struct StepEvent
+{
+    uint32_t interval;
+    uint8_t bits;
+};
+
+typedef SpscQueue<StepEvent, STEP_QUEUE_SIZE> StepQueue;
+
+// Producer side: turns planner blocks into timed step events (Bresenham
+// between the two axes, rate from the block's velocity profile)
+class StepGenerator
+{
+public:
+    StepGenerator() : step(0) { block.stepEventCount = 0; }
+
+    void load(const PlannerBlock &block);
+    // queues as many events as fit; returns true once the block is done
+    bool fill(StepQueue &queue);
+    bool isDone() const { return step >= block.stepEventCount; }
+
+private:
+    PlannerBlock block;
+    uint32_t step;
+    int32_t counter[2];
+    uint32_t absSteps[2];
+    uint8_t dirBits;
+};
+
+// Consumer side, called from the timer interrupt: pops the next event,
+// keeps track of the axis positions and returns when to be called again
+class StepTicker
+{
+public:
+    StepTicker() : sequence(0), idle(true), flush(false), underruns(0), lastBits(STEP_STOP) { setPosition(0, 0); }
+
+    STEP_ISR_ATTR uint32_t tick(StepQueue &queue, uint8_t &bits)
+    {
+        if (flush.load(std::memory_order_acquire))
+        {
+            queue.discardAll();
+            flush.store(false, std::memory_order_release);
+        }
+
+        StepEvent event;
+        if (!queue.pop(event))
+        {
+            if (!(lastBits & STEP_STOP))
+            {
+                underruns.store(underruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+            lastBits = STEP_STOP;
+            idle.store(true, std::memory_order_release);
+            bits = 0;
+            return STEP_IDLE_INTERVAL;
+        }
+
+        idle.store(false, std::memory_order_release);
+        lastBits = bits = event.bits;
+        if (!(bits & (STEP_ROTATION | STEP_PEN)))
+        {
+            return event.interval;
+        }
+        // only this side writes the positions, no need for read-modify-write atomics
+        uint32_t changing = beginChange();
+        if (bits & STEP_ROTATION)
+        {
+            positions[0].store(positions[0].load(std::memory_order_relaxed) + (bits & DIR_ROTATION ? 1 : -1), std::memory_order_relaxed);
+        }
+        if (bits & STEP_PEN)
+        {
+            positions[1].store(positions[1].load(std::memory_order_relaxed) + (bits & DIR_PEN ? 1 : -1), std::memory_order_relaxed);
+        }
+        sequence.store(changing + 1, std::memory_order_release);
+        return event.interval;
+    }
+
+    int32_t position(uint8_t axis) const { return positions[axis].load(std::memory_order_relaxed); }
+    // both axes as they were between two steps, from any task; retries
+    // while a step is being counted
+    void snapshot(int32_t &x, int32_t &y) const
+    {
+        uint32_t before, after;
+        do
+        {
+            before = sequence.load(std::memory_order_acquire);
+            x = positions[0].load(std::memory_order_relaxed);
+            y = positions[1].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+    }
+    // only while no steps are queued or running
+    void setPosition(int32_t x, int32_t y)
+    {
+        uint32_t changing = beginChange();
+        positions[0].store(x, std::memory_order_relaxed);
+        positions[1].store(y, std::memory_order_relaxed);
+        sequence.store(changing + 1, std::memory_order_release);
+    }
+
+    // idle means the last queued step has been taken
+    bool isIdle() const { return idle.load(std::memory_order_acquire); }
+    uint32_t getUnderruns() const { return underruns.load(std::memory_order_relaxed); }
+
+    // drops everything queued on the next tick; the producer must be stopped
+    void requestFlush() { flush.store(true, std::memory_order_release); }
+    bool isFlushPending() const { return flush.load(std::memory_order_acquire); }
+
+private:
+    // makes the sequence odd until it is stored again one higher
+    STEP_ISR_ATTR uint32_t beginChange()
+    {
+        uint32_t changing = sequence.load(std::memory_order_relaxed) + 1;
+        sequence.store(changing, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return changing;
+    }
+
+    std::atomic<int32_t> positions[2];
+    // odd while the positions change, see snapshot()
+    std::atomic<uint32_t> sequence;
+    std::atomic<bool> idle, flush;
+    std::atomic<uint32_t> underruns;
+    uint8_t lastBits;
+};
+
+#endif
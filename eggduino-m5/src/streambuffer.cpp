@@ -0,0 +1,96 @@
+#include <string.h>
+
+#include "streambuffer.h"
+
+#define STREAM_MASK (STREAM_BUFFER_SIZE - 1)
+
+static_assert((STREAM_BUFFER_SIZE & STREAM_MASK) == 0, "STREAM_BUFFER_SIZE must be a power of two");
+
+StreamBuffer::StreamBuffer(WaitHandler wait)
+    : wait(wait),
+      head(0),
+      tail(0),
+      released(0),
+      finished(true),
+      aborted(true),
+      stalls(0)
+{
+}
+
+uint32_t StreamBuffer::begin()
+{
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    released.store(0, std::memory_order_relaxed);
+    stalls.store(0, std::memory_order_relaxed);
+    finished.store(false, std::memory_order_relaxed);
+    aborted.store(false, std::memory_order_release);
+    return STREAM_BUFFER_SIZE;
+}
+
+bool StreamBuffer::write(const uint8_t *bytes, size_t length)
+{
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (isAborted() || length > STREAM_BUFFER_SIZE - (h - tail.load(std::memory_order_acquire)))
+    {
+        return false;
+    }
+
+    size_t at = h & STREAM_MASK;
+    size_t first = length < STREAM_BUFFER_SIZE - at ? length : STREAM_BUFFER_SIZE - at;
+    memcpy(data + at, bytes, first);
+    memcpy(data, bytes + first, length - first);
+    head.store(h + length, std::memory_order_release);
+    return true;
+}
+
+void StreamBuffer::finish()
+{
+    finished.store(true, std::memory_order_release);
+}
+
+uint32_t StreamBuffer::takeCredit()
+{
+    if (released.load(std::memory_order_relaxed) >= STREAM_CREDIT_SIZE)
+    {
+        return released.exchange(0, std::memory_order_relaxed);
+    }
+    return 0;
+}
+
+size_t StreamBuffer::read(uint8_t *buffer, size_t length)
+{
+    bool stalled = false;
+    for (;;)
+    {
+        if (isAborted())
+        {
+            return 0;
+        }
+        // finished first: everything written before it is in head then
+        bool done = finished.load(std::memory_order_acquire);
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t available = head.load(std::memory_order_acquire) - t;
+        if (available)
+        {
+            size_t count = length < available ? length : available;
+            size_t at = t & STREAM_MASK;
+            size_t first = count < STREAM_BUFFER_SIZE - at ? count : STREAM_BUFFER_SIZE - at;
+            memcpy(buffer, data + at, first);
+            memcpy(buffer + first, data, count - first);
+            tail.store(t + count, std::memory_order_release);
+            released.fetch_add(count, std::memory_order_relaxed);
+            return count;
+        }
+        if (done)
+        {
+            return 0;
+        }
+        if (!stalled)
+        {
+            stalled = true;
+            stalls.fetch_add(1, std::memory_order_relaxed);
+        }
+        wait();
+    }
+}
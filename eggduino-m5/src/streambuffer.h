@@ -0,0 +1,63 @@
+#ifndef STREAMBUFFER_H
+#define STREAMBUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "bytestream.h"
+
+// a power of two
+#define STREAM_BUFFER_SIZE 8192
+// credit goes back to the sender in pieces of this much or more
+#define STREAM_CREDIT_SIZE 2048
+
+// A job printed as it arrives over the network, without a file. The
+// sender (the websocket) writes, the print task reads.
+//
+// Flow control is by credit: the sender starts with the whole buffer as
+// credit, spends it on what it sends and gets back what has been read.
+// Sending within the credit never overflows the buffer, and as at most
+// STREAM_CREDIT_SIZE is held back the sender can always keep the buffer
+// that close to full; it only runs empty if the sender falls behind.
+class StreamBuffer : public ByteSource
+{
+public:
+    typedef void (*WaitHandler)();
+
+    // wait is called while the reader waits for data
+    StreamBuffer(WaitHandler wait);
+
+    // starts a new stream, with nobody reading; returns the first credit
+    uint32_t begin();
+
+    // sender side: false, and nothing taken, if it is more than the credit
+    // allows or the stream was aborted
+    bool write(const uint8_t *data, size_t length);
+    // the rest of the stream is buffered, read ends after it
+    void finish();
+    // read ends now
+    void abort() { aborted.store(true, std::memory_order_release); }
+    bool isAborted() const { return aborted.load(std::memory_order_acquire); }
+    // credit to give back to the sender, 0 while it is too little to send
+    uint32_t takeCredit();
+
+    // reader side: waits for data; 0 at the end
+    size_t read(uint8_t *buffer, size_t length) override;
+
+    size_t getBuffered() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+    // times the reader had to wait for the sender
+    uint32_t getStalls() const { return stalls.load(std::memory_order_relaxed); }
+
+private:
+    WaitHandler wait;
+    uint8_t data[STREAM_BUFFER_SIZE];
+    // bytes written and read so far, the buffer positions wrap around
+    std::atomic<uint32_t> head, tail;
+    // read and not given back as credit yet
+    std::atomic<uint32_t> released;
+    std::atomic<bool> finished, aborted;
+    std::atomic<uint32_t> stalls;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#include <math.h>
+
+#include "strokespeed.h"
+
+#define STROKE_SLOTS (STROKE_LOOKAHEAD + 1)
+
+StrokeSpeed::StrokeSpeed()
+{
+    begin(0, 0, 0, 0, 0);
+}
+
+void StrokeSpeed::begin(float speed, float maxSpeed, uint16_t runLength, int32_t x, int32_t y)
+{
+    this->speed = speed;
+    this->maxSpeed = maxSpeed > speed ? maxSpeed : speed;
+    this->runLength = runLength;
+    setPosition(x, y);
+}
+
+void StrokeSpeed::setPosition(int32_t x, int32_t y)
+{
+    from[0] = x;
+    from[1] = y;
+    first = count = 0;
+    flushing = false;
+}
+
+void StrokeSpeed::add(int32_t x, int32_t y)
+{
+    uint8_t slot = (first + count) % STROKE_SLOTS;
+    moves[slot][0] = x;
+    moves[slot][1] = y;
+    count++;
+}
+
+void StrokeSpeed::flush()
+{
+    flushing = count > 0;
+}
+
+bool StrokeSpeed::next(int32_t &x, int32_t &y, float &speed)
+{
+    if (!count || (count <= STROKE_LOOKAHEAD && !flushing))
+    {
+        flushing = false;
+        return false;
+    }
+
+    speed = this->speed;
+    if (maxSpeed > this->speed)
+    {
+        float run = runLength ? straightRun() / runLength : 1;
+        speed += (maxSpeed - this->speed) * (run < 1 ? run : 1);
+    }
+
+    x = from[0] = moves[first][0];
+    y = from[1] = moves[first][1];
+    first = (first + 1) % STROKE_SLOTS;
+    count--;
+    return true;
+}
+
+float StrokeSpeed::straightRun() const
+{
+    float dx = moves[first][0] - from[0];
+    float dy = moves[first][1] - from[1];
+    float run = sqrtf(dx * dx + dy * dy);
+    if (!run)
+    {
+        return 0;
+    }
+    float ux = dx / run, uy = dy / run;
+
+    const int32_t *previous = moves[first];
+    for (uint8_t i = 1; i < count && run < runLength; i++)
+    {
+        const int32_t *move = moves[(first + i) % STROKE_SLOTS];
+        dx = move[0] - previous[0];
+        dy = move[1] - previous[1];
+        float length = sqrtf(dx * dx + dy * dy);
+        if (length && (dx * ux + dy * uy) / length < STROKE_STRAIGHT_COS)
+        {
+            break;
+        }
+        run += length;
+        previous = move;
+    }
+    return run;
+}
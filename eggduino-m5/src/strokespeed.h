@@ -0,0 +1,49 @@
+#ifndef STROKESPEED_H
+#define STROKESPEED_H
+
+#include <stdint.h>
+
+// moves looked at after the one whose speed is decided
+#define STROKE_LOOKAHEAD 8
+// a run is straight while it stays within about 15 degrees of the direction
+// it started in, so gentle curves count for a while and tight ones do not
+#define STROKE_STRAIGHT_COS 0.966f
+
+// Picks the speed of each move from the shape of the stroke ahead, between
+// the path filter and the motion code. A move starting a straight run of
+// runLength steps or more goes at maxSpeed, short segments and sharp turns
+// at speed (the one safe for detail), in between in proportion to the run.
+// Slowing down for the turn at the end of a run is the planner's job.
+class StrokeSpeed
+{
+public:
+    StrokeSpeed();
+
+    // maxSpeed at or below speed keeps every move at speed; x, y is where
+    // the job starts
+    void begin(float speed, float maxSpeed, uint16_t runLength, int32_t x, int32_t y);
+    // the job continues from x, y (after H, with nothing held back)
+    void setPosition(int32_t x, int32_t y);
+
+    void add(int32_t x, int32_t y);
+    // the stroke ends here, e.g. before a command that is not a move
+    void flush();
+    // the moves to make, in order; take them all after every add or flush
+    bool next(int32_t &x, int32_t &y, float &speed);
+    // nothing held back
+    bool isEmpty() const { return !count; }
+
+private:
+    // steps the first held move goes on in about its direction
+    float straightRun() const;
+
+    float speed, maxSpeed;
+    uint16_t runLength;
+    // where the first held move starts
+    int32_t from[2];
+    int32_t moves[STROKE_LOOKAHEAD + 1][2];
+    uint8_t first, count;
+    bool flushing;
+};
+
+#endif
@@ -0,0 +1,435 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "traveloptimizer.h"
+
+#define GRID_CELLS (TRAVEL_GRID_COLUMNS * TRAVEL_GRID_ROWS)
+
+static bool isReversible(uint16_t moves)
+{
+    return moves && moves <= TRAVEL_MAX_REVERSED_MOVES;
+}
+
+// commands that keep their place in the job, segments are not moved across them
+static bool isBarrier(CommandType type)
+{
+    return type != CMD_MOVE && type != CMD_PEN_DOWN && type != CMD_PEN_UP &&
+           type != CMD_PROGRESS && type != CMD_NONE;
+}
+
+static void formatDegrees(char *text, size_t size, int32_t steps, uint16_t stepsPerRotation)
+{
+    // three decimals bring back the exact step
+    snprintf(text, size, "%.3f", steps * 360.0 / stepsPerRotation);
+    char *end = text + strlen(text);
+    while (end[-1] == '0')
+    {
+        *--end = 0;
+    }
+    if (end[-1] == '.')
+    {
+        *--end = 0;
+    }
+}
+
+TravelOptimizer::TravelOptimizer(SeekableSource &source, ByteSink &sink, uint16_t stepsPerRotation)
+    : source(source),
+      sink(sink),
+      stepsPerRotation(stepsPerRotation),
+      failed(false),
+      segments(NULL),
+      count(0),
+      position{0, 0},
+      ends(NULL),
+      segmentCount(0),
+      reversedCount(0)
+{
+}
+
+TravelOptimizer::~TravelOptimizer()
+{
+    free(segments);
+    free(ends);
+}
+
+bool TravelOptimizer::run()
+{
+    segments = (Segment *)malloc(TRAVEL_MAX_SEGMENTS * sizeof(Segment));
+    ends = (uint16_t *)malloc(TRAVEL_MAX_SEGMENTS * 2 * sizeof(uint16_t));
+    if (!segments || !ends || !source.seek(0))
+    {
+        return false;
+    }
+
+    TextJobReader reader(source, stepsPerRotation);
+    Command cmd;
+    JobMark mark;
+    // where the job itself is, its next segment starts there
+    int32_t at[2] = {0, 0};
+    bool penDown = false, copying = false;
+    int32_t shift = 0;
+    while (!failed)
+    {
+        reader.mark(mark);
+        bool more = reader.next(cmd);
+        if (copying)
+        {
+            if (!more)
+            {
+                break;
+            }
+            if (cmd.type == CMD_MOVE && shift)
+            {
+                writeMove(cmd.x + shift, cmd.y);
+            }
+            else
+            {
+                writeLine(reader.line());
+            }
+            if (cmd.type == CMD_MOVE)
+            {
+                at[0] = cmd.x;
+                at[1] = position[1] = cmd.y;
+                position[0] = cmd.x + shift;
+            }
+            else if (cmd.type == CMD_HOME)
+            {
+                at[0] = at[1] = position[0] = position[1] = 0;
+            }
+            copying = cmd.type != CMD_PEN_UP;
+            continue;
+        }
+
+        if (penDown && (!more || isBarrier(cmd.type)))
+        {
+            // a segment interrupted by another command (or the end of the
+            // job) is copied in its own order, from where the job starts it
+            Segment open = segments[count];
+            flush(reader);
+            shift = turnsBetween(position[0], open.start[0]);
+            writeMove(open.start[0] + shift, open.start[1]);
+            seek(reader, open.offset);
+            penDown = false;
+            copying = true;
+            continue;
+        }
+        if (!more)
+        {
+            break;
+        }
+
+        switch (cmd.type)
+        {
+        case CMD_MOVE:
+            at[0] = cmd.x;
+            at[1] = cmd.y;
+            if (penDown)
+            {
+                Segment &segment = segments[count];
+                segment.finish[0] = cmd.x;
+                segment.finish[1] = cmd.y;
+                if (segment.moves < UINT16_MAX)
+                {
+                    segment.moves++;
+                }
+            }
+            break;
+        case CMD_PEN_DOWN:
+            if (!penDown)
+            {
+                if (count == TRAVEL_MAX_SEGMENTS)
+                {
+                    flush(reader);
+                }
+                Segment &segment = segments[count];
+                segment.offset = mark.offset;
+                segment.start[0] = segment.finish[0] = at[0];
+                segment.start[1] = segment.finish[1] = at[1];
+                segment.moves = 0;
+                segment.used = false;
+                penDown = true;
+            }
+            break;
+        case CMD_PEN_UP:
+            if (penDown)
+            {
+                reader.mark(mark);
+                segments[count++].end = mark.offset;
+                penDown = false;
+            }
+            else
+            {
+                flush(reader);
+                writeLine(reader.line());
+            }
+            break;
+        case CMD_PROGRESS:
+        case CMD_NONE:
+            break;
+        default:
+            flush(reader);
+            writeLine(reader.line());
+            if (cmd.type == CMD_HOME)
+            {
+                at[0] = at[1] = position[0] = position[1] = 0;
+            }
+            break;
+        }
+    }
+
+    flush(reader);
+    return !failed;
+}
+
+// writes the segments read so far and continues reading where it was
+void TravelOptimizer::flush(TextJobReader &reader)
+{
+    if (!count)
+    {
+        return;
+    }
+    JobMark mark;
+    reader.mark(mark);
+    optimize();
+    count = 0;
+    seek(reader, mark.offset);
+}
+
+void TravelOptimizer::optimize()
+{
+    buildGrid();
+    uint32_t found;
+    while (!failed && nearest(position[0], position[1], found))
+    {
+        use(found >> 1);
+        writeSegment(segments[found >> 1], found & 1);
+    }
+}
+
+void TravelOptimizer::buildGrid()
+{
+    int32_t top = INT32_MAX, bottom = INT32_MIN;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        const Segment &segment = segments[i];
+        top = std::min(top, std::min(segment.start[1], segment.finish[1]));
+        bottom = std::max(bottom, std::max(segment.start[1], segment.finish[1]));
+    }
+    gridTop = top;
+    cellHeight = (bottom - top) / TRAVEL_GRID_ROWS + 1;
+    cellWidth = std::max(1, stepsPerRotation / TRAVEL_GRID_COLUMNS);
+
+    // the ends sorted by cell, each cell's ends from cellStart[cell]
+    memset(cellRemaining, 0, sizeof(cellRemaining));
+    for (uint16_t i = 0; i < count; i++)
+    {
+        cellRemaining[cellOf(segments[i].start[0], segments[i].start[1])]++;
+        if (isReversible(segments[i].moves))
+        {
+            cellRemaining[cellOf(segments[i].finish[0], segments[i].finish[1])]++;
+        }
+    }
+    cellStart[0] = 0;
+    for (uint16_t cell = 0; cell < GRID_CELLS; cell++)
+    {
+        cellStart[cell + 1] = cellStart[cell] + cellRemaining[cell];
+    }
+    for (uint16_t i = 0; i < count; i++)
+    {
+        uint16_t cell = cellOf(segments[i].start[0], segments[i].start[1]);
+        ends[cellStart[cell + 1] - cellRemaining[cell]--] = i * 2;
+        if (isReversible(segments[i].moves))
+        {
+            cell = cellOf(segments[i].finish[0], segments[i].finish[1]);
+            ends[cellStart[cell + 1] - cellRemaining[cell]--] = i * 2 + 1;
+        }
+    }
+    for (uint16_t cell = 0; cell < GRID_CELLS; cell++)
+    {
+        cellRemaining[cell] = cellStart[cell + 1] - cellStart[cell];
+    }
+}
+
+uint16_t TravelOptimizer::cellOf(int32_t x, int32_t y) const
+{
+    // columns go round the egg, rows cover the pen range of the run
+    int32_t rotation = (x % stepsPerRotation + stepsPerRotation) % stepsPerRotation;
+    int32_t column = (int64_t)rotation * TRAVEL_GRID_COLUMNS / stepsPerRotation;
+    int32_t row = (y - gridTop) / cellHeight;
+    row = row < 0 ? 0 : row >= TRAVEL_GRID_ROWS ? TRAVEL_GRID_ROWS - 1 : row;
+    return row * TRAVEL_GRID_COLUMNS + column;
+}
+
+bool TravelOptimizer::nearest(int32_t x, int32_t y, uint32_t &found)
+{
+    uint16_t center = cellOf(x, y);
+    int32_t column = center % TRAVEL_GRID_COLUMNS, row = center / TRAVEL_GRID_COLUMNS;
+    int32_t cellSize = std::min(cellWidth, cellHeight);
+    int32_t rings = std::max(TRAVEL_GRID_COLUMNS / 2, TRAVEL_GRID_ROWS);
+    int64_t best = INT64_MAX;
+    bool any = false;
+
+    // cells in rings around the pen's cell, until nothing further out can be closer
+    for (int32_t ring = 0; ring <= rings; ring++)
+    {
+        for (int32_t dy = -ring; dy <= ring; dy++)
+        {
+            int32_t cellRow = row + dy;
+            if (cellRow < 0 || cellRow >= TRAVEL_GRID_ROWS)
+            {
+                continue;
+            }
+            // the top and bottom rows of a ring are whole, the others only its sides
+            int32_t step = dy == -ring || dy == ring ? 1 : 2 * ring;
+            for (int32_t dx = -ring; dx <= ring; dx += step)
+            {
+                int32_t cellColumn = ((column + dx) % TRAVEL_GRID_COLUMNS + TRAVEL_GRID_COLUMNS) % TRAVEL_GRID_COLUMNS;
+                uint16_t cell = cellRow * TRAVEL_GRID_COLUMNS + cellColumn;
+                if (!cellRemaining[cell])
+                {
+                    continue;
+                }
+                for (uint16_t i = cellStart[cell]; i < cellStart[cell + 1]; i++)
+                {
+                    uint16_t end = ends[i];
+                    const Segment &segment = segments[end >> 1];
+                    if (segment.used)
+                    {
+                        continue;
+                    }
+                    int64_t d = distance(x, y, end & 1 ? segment.finish : segment.start);
+                    // ties go to the earlier segment, in its own direction
+                    if (d < best || (d == best && end < found))
+                    {
+                        best = d;
+                        found = end;
+                        any = true;
+                    }
+                }
+            }
+        }
+        if (any && best <= (int64_t)ring * cellSize * ring * cellSize)
+        {
+            break;
+        }
+    }
+    return any;
+}
+
+int64_t TravelOptimizer::distance(int32_t x, int32_t y, const int32_t *to) const
+{
+    // around the egg, whichever way is shorter
+    int32_t dx = ((x - to[0]) % stepsPerRotation + stepsPerRotation) % stepsPerRotation;
+    dx = std::min(dx, stepsPerRotation - dx);
+    int64_t dy = y - to[1];
+    return (int64_t)dx * dx + dy * dy;
+}
+
+void TravelOptimizer::use(uint32_t index)
+{
+    Segment &segment = segments[index];
+    segment.used = true;
+    cellRemaining[cellOf(segment.start[0], segment.start[1])]--;
+    if (isReversible(segment.moves))
+    {
+        cellRemaining[cellOf(segment.finish[0], segment.finish[1])]--;
+    }
+}
+
+void TravelOptimizer::writeSegment(const Segment &segment, bool reverse)
+{
+    const int32_t *first = reverse ? segment.finish : segment.start;
+    const int32_t *last = reverse ? segment.start : segment.finish;
+    int32_t shift = turnsBetween(position[0], first[0]);
+    writeMove(first[0] + shift, first[1]);
+    writeLine("P1");
+
+    TextJobReader reader(source, stepsPerRotation);
+    seek(reader, segment.offset);
+    Command cmd;
+    JobMark mark;
+    uint16_t moves = 0;
+    while (!failed)
+    {
+        reader.mark(mark);
+        if (mark.offset >= segment.end || !reader.next(cmd))
+        {
+            break;
+        }
+        if (cmd.type != CMD_MOVE)
+        {
+            continue;
+        }
+        if (reverse)
+        {
+            if (moves < TRAVEL_MAX_REVERSED_MOVES)
+            {
+                reversedMoves[moves][0] = cmd.x;
+                reversedMoves[moves][1] = cmd.y;
+                moves++;
+            }
+        }
+        else if (shift)
+        {
+            writeMove(cmd.x + shift, cmd.y);
+        }
+        else
+        {
+            writeLine(reader.line());
+        }
+    }
+
+    if (reverse)
+    {
+        // the last move is where the reversed segment starts
+        for (int32_t i = moves - 2; i >= 0; i--)
+        {
+            writeMove(reversedMoves[i][0] + shift, reversedMoves[i][1]);
+        }
+        writeMove(segment.start[0] + shift, segment.start[1]);
+        reversedCount++;
+    }
+    writeLine("P0");
+
+    position[0] = last[0] + shift;
+    position[1] = last[1];
+    segmentCount++;
+}
+
+// the whole turns that bring x within half a turn of the pen
+int32_t TravelOptimizer::turnsBetween(int32_t pen, int32_t x) const
+{
+    return floor((double)(pen - x) / stepsPerRotation + .5) * stepsPerRotation;
+}
+
+bool TravelOptimizer::seek(TextJobReader &reader, uint32_t offset)
+{
+    JobMark mark = {};
+    mark.offset = offset;
+    reader.restore(mark);
+    if (!source.seek(offset))
+    {
+        failed = true;
+    }
+    return !failed;
+}
+
+void TravelOptimizer::writeMove(int32_t x, int32_t y)
+{
+    char rotation[16], pen[16], line[40];
+    formatDegrees(rotation, sizeof(rotation), x, stepsPerRotation);
+    formatDegrees(pen, sizeof(pen), y, stepsPerRotation);
+    snprintf(line, sizeof(line), "T %s %s", rotation, pen);
+    writeLine(line);
+}
+
+void TravelOptimizer::writeLine(const char *line)
+{
+    size_t length = strlen(line);
+    if (sink.write((const uint8_t *)line, length) != length || sink.write((const uint8_t *)"\n", 1) != 1)
+    {
+        failed = true;
+    }
+}
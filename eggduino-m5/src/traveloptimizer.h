@@ -0,0 +1,79 @@
+#ifndef TRAVELOPTIMIZER_H
+#define TRAVELOPTIMIZER_H
+
+#include "bytestream.h"
+#include "command.h"
+#include "jobreader.h"
+
+// segments reordered together; a longer run is optimised in parts
+#define TRAVEL_MAX_SEGMENTS 2048
+// segments with more moves are only drawn in their own direction
+#define TRAVEL_MAX_REVERSED_MOVES 256
+// the nearest segment is searched in a grid over the segment ends
+#define TRAVEL_GRID_COLUMNS 32
+#define TRAVEL_GRID_ROWS 16
+
+// Rewrites a text job so the pen travels less while it is up.
+//
+// The pen-down segments of a run (everything between two other commands:
+// S, H, M...) are drawn nearest first, reversed when their end is closer,
+// and turned by whole rotations so reaching one never takes more than half
+// a turn around the egg. A segment with another command in it stays where
+// it is. The pen-up moves and Z lines of a run are left out; the firmware
+// estimates progress itself.
+class TravelOptimizer
+{
+public:
+    TravelOptimizer(SeekableSource &source, ByteSink &sink, uint16_t stepsPerRotation);
+    ~TravelOptimizer();
+
+    // false if the job could not be read or the copy written
+    bool run();
+
+    uint32_t getSegments() const { return segmentCount; }
+    uint32_t getReversed() const { return reversedCount; }
+
+private:
+    struct Segment
+    {
+        // the P1 line and the end of the P0 line
+        uint32_t offset, end;
+        int32_t start[2], finish[2];
+        uint16_t moves;
+        bool used;
+    };
+
+    void flush(TextJobReader &reader);
+    void optimize();
+    void buildGrid();
+    uint16_t cellOf(int32_t x, int32_t y) const;
+    // the closest unused segment end, as segment * 2 + 1 for a reversed segment
+    bool nearest(int32_t x, int32_t y, uint32_t &found);
+    int64_t distance(int32_t x, int32_t y, const int32_t *to) const;
+    void use(uint32_t index);
+    void writeSegment(const Segment &segment, bool reverse);
+    int32_t turnsBetween(int32_t pen, int32_t x) const;
+    bool seek(TextJobReader &reader, uint32_t offset);
+    void writeMove(int32_t x, int32_t y);
+    void writeLine(const char *line);
+
+    SeekableSource &source;
+    ByteSink &sink;
+    uint16_t stepsPerRotation;
+    bool failed;
+
+    Segment *segments;
+    uint16_t count;
+    // where the copy has moved the pen to
+    int32_t position[2];
+
+    uint16_t *ends;
+    uint16_t cellStart[TRAVEL_GRID_COLUMNS * TRAVEL_GRID_ROWS + 1];
+    uint16_t cellRemaining[TRAVEL_GRID_COLUMNS * TRAVEL_GRID_ROWS];
+    int32_t cellWidth, cellHeight, gridTop;
+    int32_t reversedMoves[TRAVEL_MAX_REVERSED_MOVES][2];
+
+    uint32_t segmentCount, reversedCount;
+};
+
+#endif
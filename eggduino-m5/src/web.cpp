@@ -1,16 +1,475 @@
 #include <SPIFFS.h>
 #include "web.h"
+#include "esp_heap_caps.h"
 #include "esp_wifi.h"
 #include <Update.h>
+#include <memory>
+#include "traveloptimizer.h"
 
 const String extension = ".egg";
+const String binaryExtension = ".eggb";
+// gzip compressed text jobs, inflated as they print and never compiled
+const String compressedExtension = ".egg.gz";
+// text jobs compiled to the binary format at upload, next to the .egg
+const String compiledExtension = ".eggc";
+const String tempExtension = ".tmp";
+// cached facts about a text job, next to the .egg
+const String infoExtension = ".info";
+// travel optimised copies are saved as <job>-optimized.egg
+const String optimizedSuffix = "-optimized";
+
+// below the print task, optimising never holds up a print
+#define OPTIMIZE_TASK_PRIORITY 1
+
+#define JSON_STATUS_SIZE 440
+#define JSON_RESPONSE_SIZE 420
+// a full queue with the longest names
+#define JSON_QUEUE_SIZE 1600
+// the longest array element of a streamed response, e.g. a job's entry with
+// its layer names
+#define JSON_ELEMENT_SIZE 1024
+// five histograms with every bucket used, and the websocket counters
+#define JSON_METRICS_SIZE 1900
+
+// between metrics on the websocket while printing, ms
+#define METRICS_INTERVAL 5000
+// longest websocket text command, "stream-begin <name>"
+#define WS_COMMAND_SIZE 64
+
+// binary websocket frames start with one of these, numbers follow little
+// endian: progress is lines (4 bytes), percent (1), eta (4); position is
+// x within a turn (2), y (2, signed), steps per rotation (2), pen height
+// (1, 0 down to 255 up) and 1 if moving (1)
+#define WS_FRAME_PROGRESS 1
+#define WS_FRAME_PROGRESS_SIZE 10
+#define WS_FRAME_POSITION 2
+#define WS_FRAME_POSITION_SIZE 9
+
+// what the broadcaster keeps the latest of, a new client is sent them in
+// this order
+enum BroadcastSlot : uint8_t
+{
+    SLOT_PROGRESS,
+    SLOT_POSITION,
+    SLOT_STATUS,
+    SLOT_QUEUE,
+    SLOT_METRICS,
+};
+
+static bool endsWith(const char *text, const String &suffix)
+{
+    size_t length = strlen(text);
+    return length >= suffix.length() && !strcmp(text + length - suffix.length(), suffix.c_str());
+}
+
+// writes a job's name: the path without the root folder and the extension
+static void writeJobName(JsonWriter &json, const char *path, size_t skip)
+{
+    const char *dot = strrchr(path, '.');
+    size_t length = strlen(path);
+    size_t end = dot && (size_t)(dot - path) > skip ? dot - path : length;
+    if (endsWith(path, compressedExtension))
+    {
+        end = length - compressedExtension.length();
+    }
+    json.value(skip < end ? path + skip : "", skip < end ? end - skip : 0);
+}
+
+// written at upload so listing the files and starting a print need no scan
+// of the jobs
+struct JobInfo
+{
+    float seconds;
+    // the estimate only holds for the timing it was made with
+    MotionParameters parameters;
+    JobStats stats;
+};
+
+// why an upload was refused, kept with its request until the response
+struct UploadError
+{
+    uint32_t line;
+    const char *message;
+};
+
+// A text job as it is written to the card (an upload, or the copy the
+// optimizer makes): every line checked and estimated, compiled to the
+// binary format if asked, and its JobInfo written once it is all there
+class JobUpload
+{
+public:
+    // no compiledPath, no compiling
+    JobUpload(FS &fs, const String &infoPath, const String &compiledPath, const MotionParameters &parameters)
+        : fs(fs),
+          infoPath(infoPath),
+          compiledPath(compiledPath),
+          parameters(parameters),
+          estimator(this->parameters),
+          validator(parameters.stepsPerRotation, &estimator),
+          sink(NULL),
+          compiler(NULL)
+    {
+        if (!compiledPath.length())
+        {
+            return;
+        }
+        // written under a temporary name so an interrupted upload never
+        // leaves a partial job behind
+        compiledFile = fs.open(compiledPath + tempExtension, "w");
+        if (compiledFile)
+        {
+            sink = new FileSink(compiledFile);
+            compiler = new JobCompiler(*sink, parameters.stepsPerRotation);
+            if (!compiler->begin())
+            {
+                endCompile(false);
+            }
+        }
+    }
+
+    ~JobUpload()
+    {
+        endCompile(false);
+    }
+
+    // false from the first bad line on
+    bool write(const uint8_t *data, size_t length)
+    {
+        if (!validator.write(data, length))
+        {
+            return false;
+        }
+        if (compiler && !compiler->write(data, length))
+        {
+            endCompile(false);
+        }
+        return true;
+    }
+
+    // false if the job has a bad line, then nothing is kept
+    bool end()
+    {
+        bool valid = validator.end();
+        endCompile(valid);
+        if (!valid)
+        {
+            return false;
+        }
+
+        JobInfo info;
+        info.seconds = estimator.end();
+        info.parameters = parameters;
+        info.stats = validator.getStats();
+        File infoFile = fs.open(infoPath, "w");
+        if (infoFile)
+        {
+            infoFile.write((const uint8_t *)&info, sizeof(JobInfo));
+            infoFile.close();
+        }
+        return true;
+    }
+
+    void getError(UploadError &error) const
+    {
+        error.line = validator.getErrorLine();
+        error.message = validator.getError();
+    }
+
+private:
+    void endCompile(bool keep)
+    {
+        if (!compiledFile)
+        {
+            return;
+        }
+        keep = keep && compiler && compiler->end() && sink->flush();
+        delete compiler;
+        delete sink;
+        compiler = NULL;
+        sink = NULL;
+        compiledFile.close();
+
+        String temp = compiledPath + tempExtension;
+        if (!keep || !fs.rename(temp, compiledPath))
+        {
+            fs.remove(temp);
+        }
+    }
+
+    FS &fs;
+    String infoPath, compiledPath;
+    MotionParameters parameters;
+    JobEstimator estimator;
+    JobValidator validator;
+    File compiledFile;
+    FileSink *sink;
+    JobCompiler *compiler;
+};
+
+static void sendJson(AsyncWebServerRequest *req, int code, const JsonWriter &json)
+{
+    req->send(code, "application/json", json.c_str());
+}
+
+// the elements of a JSON array sent as a chunked response
+class JsonArraySource
+{
+public:
+    virtual ~JsonArraySource() {}
+    // writes the current element; false when there are no more
+    virtual bool write(JsonWriter &json) = 0;
+    // called once the current element fitted in a chunk
+    virtual void next() = 0;
+};
+
+class FileListSource : public JsonArraySource
+{
+public:
+    // lists limit jobs (0 for all) after skipping the first offset ones
+    FileListSource(FS &fs, File dir, size_t skip, uint32_t offset, uint32_t limit, const MotionParameters &parameters)
+        : fs(fs), dir(dir), skip(skip), offset(offset), limit(limit), listed(0), parameters(parameters) {}
+
+    bool write(JsonWriter &json) override
+    {
+        if (limit && listed >= limit)
+        {
+            return false;
+        }
+        while (!file)
+        {
+            file = dir.openNextFile();
+            if (!file)
+            {
+                return false;
+            }
+            if (!endsWith(file.name(), extension) && !endsWith(file.name(), binaryExtension) &&
+                !endsWith(file.name(), compressedExtension))
+            {
+                file = File();
+            }
+            else if (offset)
+            {
+                offset--;
+                file = File();
+            }
+        }
+
+        json.beginObject().key("name");
+        writeJobName(json, file.name(), skip);
+        json.member("size", (unsigned long)file.size())
+            .member("modified", (unsigned long)file.getLastWrite());
+
+        JobInfo info;
+        if (readInfo(info))
+        {
+            // degrees, rounded outwards
+            const JobStats &stats = info.stats;
+            json.member("lines", stats.lines)
+                .member("penLifts", stats.penLifts)
+                .member("drawDistance", (long)stats.drawDistance)
+                .member("travelDistance", (long)stats.travelDistance)
+                .key("bounds")
+                .beginArray()
+                .value((long)floorf(stats.minX))
+                .value((long)floorf(stats.minY))
+                .value((long)ceilf(stats.maxX))
+                .value((long)ceilf(stats.maxY))
+                .endArray()
+                .key("layerNames")
+                .beginArray();
+            for (uint16_t i = 0; i < stats.layerCount && i < JOB_STATS_LAYERS; i++)
+            {
+                json.value(stats.layers[i]);
+            }
+            json.endArray();
+            if (hasSameTiming(info.parameters, parameters))
+            {
+                json.member("duration", (unsigned long)info.seconds);
+            }
+        }
+        json.endObject();
+        return true;
+    }
+
+    void next() override
+    {
+        file = File();
+        listed++;
+    }
+
+private:
+    bool readInfo(JobInfo &info)
+    {
+        if (!endsWith(file.name(), extension))
+        {
+            return false;
+        }
+        char path[128];
+        const char *name = file.name();
+        size_t base = strlen(name) - extension.length();
+        if (base + infoExtension.length() >= sizeof(path))
+        {
+            return false;
+        }
+        memcpy(path, name, base);
+        strcpy(path + base, infoExtension.c_str());
+        if (!fs.exists(path))
+        {
+            return false;
+        }
+        File infoFile = fs.open(path);
+        bool valid = infoFile.read((uint8_t *)&info, sizeof(JobInfo)) == sizeof(JobInfo);
+        infoFile.close();
+        return valid;
+    }
+
+    FS &fs;
+    File dir, file;
+    size_t skip;
+    uint32_t offset, limit, listed;
+    MotionParameters parameters;
+};
+
+class NetworkListSource : public JsonArraySource
+{
+public:
+    NetworkListSource(int count) : count(count), index(0) {}
+
+    bool write(JsonWriter &json) override
+    {
+        if (index >= count)
+        {
+            return false;
+        }
+        json.beginObject()
+            .member("ssid", WiFi.SSID(index).c_str())
+            .member("encryptionType", (int)WiFi.encryptionType(index))
+            .member("rssi", (int)WiFi.RSSI(index))
+            .member("channel", (int)WiFi.channel(index))
+            .member("bssid", WiFi.BSSIDstr(index).c_str())
+            .endObject();
+        return true;
+    }
+
+    void next() override { index++; }
+
+private:
+    int count, index;
+};
+
+// streams the array, holding back an element that does not fit the chunk.
+// One that does not fit an empty chunk is written aside and sent in pieces;
+// a chunk is never left empty before the end, that would end the response
+static void sendJsonArray(AsyncWebServerRequest *req, JsonArraySource *items)
+{
+    struct Context
+    {
+        std::unique_ptr<JsonArraySource> items;
+        JsonWriter::State state;
+        bool started, finished;
+        // the element being sent in pieces, and how much of it has gone
+        std::unique_ptr<char[]> element;
+        size_t elementLength, elementSent;
+    };
+    std::shared_ptr<Context> context(new Context());
+    context->items.reset(items);
+    context->started = context->finished = false;
+    context->elementLength = context->elementSent = 0;
+
+    req->send(req->beginChunkedResponse("application/json", [context](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        auto sendPiece = [&]() {
+            size_t piece = std::min(maxLen, context->elementLength - context->elementSent);
+            memcpy(buffer, context->element.get() + context->elementSent, piece);
+            context->elementSent += piece;
+            return piece;
+        };
+        if (context->elementSent == context->elementLength && context->finished)
+        {
+            return 0;
+        }
+        if (!maxLen)
+        {
+            return RESPONSE_TRY_AGAIN;
+        }
+
+        if (context->elementSent < context->elementLength)
+        {
+            return sendPiece();
+        }
+
+        JsonWriter json((char *)buffer, maxLen, context->state);
+        if (!context->started)
+        {
+            json.beginArray();
+            context->started = !json.overflowed();
+        }
+        while (context->started)
+        {
+            auto saved = json.save();
+            bool more = context->items->write(json);
+            if (!more)
+            {
+                json.endArray();
+            }
+            if (json.overflowed())
+            {
+                json.restore(saved);
+                break;
+            }
+            if (!more)
+            {
+                context->finished = true;
+                break;
+            }
+            context->items->next();
+        }
+        context->state = json.save();
+        if (json.length())
+        {
+            return json.length();
+        }
+
+        // not even the next element fits
+        if (!context->element)
+        {
+            context->element.reset(new char[JSON_ELEMENT_SIZE]);
+        }
+        JsonWriter element(context->element.get(), JSON_ELEMENT_SIZE, context->state);
+        if (!context->started)
+        {
+            element.beginArray();
+            context->started = true;
+        }
+        bool more = context->items->write(element);
+        if (!more)
+        {
+            element.endArray();
+            context->finished = true;
+        }
+        else if (element.overflowed())
+        {
+            // too long to send at all, left out so the rest is still valid
+            context->items->next();
+            return RESPONSE_TRY_AGAIN;
+        }
+        else
+        {
+            context->items->next();
+        }
+        context->state = element.save();
+        context->elementLength = element.length();
+        context->elementSent = 0;
+        return sendPiece();
+    }));
+}
 
 Web::Web(FS &fs, Printer &printer, String rootPath, uint16_t port)
     : _fs(fs),
       _printer(printer),
       _rootPath(rootPath),
       _server(port),
-      _ws("/api/ws")
+      _ws("/api/ws"),
+      _stream([]() { vTaskDelay(1); })
 {
 }
 
@@ -18,9 +477,18 @@ void Web::begin()
 {
     SPIFFS.begin();
     _fs.mkdir(_rootPath);
+    _queue.begin();
 
     _server.on("/api/print/*", HTTP_POST, std::bind(&Web::handlePrint, this, std::placeholders::_1));
+    // before /api/queue, which would take these too
+    _server.on("/api/queue/*", HTTP_POST | HTTP_PATCH | HTTP_DELETE, std::bind(&Web::handleQueueEntry, this, std::placeholders::_1));
+    _server.on("/api/queue", HTTP_GET | HTTP_PATCH, std::bind(&Web::handleQueue, this, std::placeholders::_1));
+    _server.on("/api/override", HTTP_GET | HTTP_PATCH, std::bind(&Web::handleOverride, this, std::placeholders::_1));
+    _server.on("/api/websocket", HTTP_GET | HTTP_PATCH, std::bind(&Web::handleWebSocket, this, std::placeholders::_1));
+    _server.on("/api/metrics", HTTP_GET, std::bind(&Web::handleMetrics, this, std::placeholders::_1));
+    _server.on("/api/resume", HTTP_GET | HTTP_POST | HTTP_DELETE, std::bind(&Web::handleResume, this, std::placeholders::_1));
     _server.on("/api/command", HTTP_POST, std::bind(&Web::handlePrinterCommand, this, std::placeholders::_1));
+    _server.on("/api/optimize/*", HTTP_POST, std::bind(&Web::handleOptimize, this, std::placeholders::_1));
 
     _server.on("/api/wifi/scan", HTTP_GET, std::bind(&Web::handleWifiScan, this, std::placeholders::_1));
     _server.on("/api/wifi/connect", HTTP_POST, std::bind(&Web::handleWifiConnect, this, std::placeholders::_1));
@@ -59,70 +527,627 @@ void Web::begin()
         response->addHeader("Connection", "close");
         req->send(response);
 
-        delay(1000);
-        ESP.restart();
-    });
+        delay(1000);
+        ESP.restart();
+    });
+
+    _server.serveStatic("/", SPIFFS, "/", "public,max-age=3600,immutable");
+    _server.addHandler(&_ws);
+    _server.onNotFound([](AsyncWebServerRequest *req) {
+        req->send(SPIFFS, "/index.html");
+    });
+
+    _ws.onEvent([this](AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
+        if (type == WS_EVT_CONNECT)
+        {
+            // loop() sends it everything
+            if (!_joined.push(client->id()))
+            {
+                client->close();
+            }
+        }
+        else if (type == WS_EVT_DISCONNECT)
+        {
+            if (client->id() == _streamClient)
+            {
+                // gone before the end of its job, the rest will not come
+                _streamClient = 0;
+                _printer.stop();
+            }
+        }
+        else if (type == WS_EVT_DATA)
+        {
+            AwsFrameInfo *info = (AwsFrameInfo *)arg;
+            if (info->message_opcode == WS_BINARY)
+            {
+                streamData(client, data, len);
+            }
+            else if (len > 7 && strncmp("stream-", (const char *)data, 7) == 0)
+            {
+                handleStreamCommand(client, (const char *)data, len);
+            }
+            else if (len == 8 && strncmp("__ping__", (const char *)data, 8) == 0)
+            {
+                client->text("__pong__");
+            }
+            else if (len > 5 && len < 10 && strncmp("feed=", (const char *)data, 5) == 0)
+            {
+                // the override as the client drags it, without a request each
+                char percent[5] = {0};
+                memcpy(percent, data + 5, len - 5);
+                _printer.setFeedOverride(atoi(percent));
+            }
+        }
+    });
+
+    _server.begin();
+}
+
+void Web::loop()
+{
+    // only the latest progress and one status are worth sending
+    PrinterEvent event, progress;
+    bool hasProgress = false, hasStatus = false;
+    while (_printer.events().pop(event))
+    {
+        if (event.type == EVENT_STATUS)
+        {
+            hasStatus = true;
+        }
+        else
+        {
+            progress = event;
+            hasProgress = true;
+        }
+    }
+
+    uint32_t joined;
+    while (_joined.pop(joined))
+    {
+        if (!_broadcast.addClient(joined))
+        {
+            _sink.close(joined);
+        }
+        // it gets the status as it is now, not the last one sent
+        hasStatus = true;
+    }
+
+    if (hasProgress)
+    {
+        publishProgress(progress);
+    }
+
+    int8_t optimized = _optimizeResult;
+    if (optimized)
+    {
+        char buff[120];
+        JsonWriter json(buff, sizeof(buff));
+        json.beginObject()
+            .member("optimized", _optimizeName.c_str())
+            .member("ok", optimized > 0)
+            .endObject();
+        _ws.textAll(buff);
+        _optimizeResult = 0;
+        _optimizing = false;
+    }
+
+    runQueue();
+    if (_queueChanged.exchange(false))
+    {
+        publishQueue();
+    }
+    if (hasStatus || _statusChanged.exchange(false))
+    {
+        publishStatus();
+    }
+
+    uint32_t streamClient = _streamClient;
+    if (streamClient)
+    {
+        if (!_printer.isStreaming())
+        {
+            // stopped from the machine or another client
+            _streamClient = 0;
+            sendStream(streamClient, "error", "stopped");
+        }
+        else
+        {
+            uint32_t credit = _stream.takeCredit();
+            if (credit)
+            {
+                sendStream(streamClient, "credit", credit);
+            }
+        }
+    }
+
+    _loopStack = uxTaskGetStackHighWaterMark(NULL);
+    uint32_t now = millis();
+    if (_printer.isPrinting() && _ws.count() && now - _lastMetrics >= METRICS_INTERVAL)
+    {
+        _lastMetrics = now;
+        publishMetrics();
+    }
+    uint8_t positionRate = _positionRate;
+    if (positionRate && _ws.count() && now - _lastPosition >= 1000u / positionRate)
+    {
+        _lastPosition = now;
+        publishPosition();
+    }
+    _broadcast.flush(now);
+}
+
+SinkState WebSocketSink::getState(uint32_t id)
+{
+    AsyncWebSocketClient *client = _ws.client(id);
+    if (!client || client->status() != WS_CONNECTED)
+    {
+        return SINK_GONE;
+    }
+    return client->queueIsFull() ? SINK_FULL : SINK_READY;
+}
+
+void WebSocketSink::send(uint32_t id, const uint8_t *data, size_t length, bool binary)
+{
+    AsyncWebSocketClient *client = _ws.client(id);
+    if (!client)
+    {
+        return;
+    }
+    if (binary)
+    {
+        client->binary(data, length);
+    }
+    else
+    {
+        client->text((const char *)data, length);
+    }
+}
+
+void WebSocketSink::close(uint32_t id)
+{
+    AsyncWebSocketClient *client = _ws.client(id);
+    if (client)
+    {
+        client->close();
+    }
+}
+
+void Web::publishProgress(const PrinterEvent &progress)
+{
+    uint8_t frame[WS_FRAME_PROGRESS_SIZE];
+    frame[0] = WS_FRAME_PROGRESS;
+    memcpy(&frame[1], &progress.lines, 4);
+    frame[5] = progress.percent;
+    memcpy(&frame[6], &progress.remainingSeconds, 4);
+    _broadcast.publish(SLOT_PROGRESS, frame, sizeof(frame), true);
+}
+
+void Web::publishPosition()
+{
+    MachinePosition position;
+    _printer.samplePosition(position);
+    if (position.x == _position.x && position.y == _position.y &&
+        position.penHeight == _position.penHeight && position.moving == _position.moving)
+    {
+        return;
+    }
+    _position = position;
+
+    int16_t y = position.y < INT16_MIN ? INT16_MIN : position.y > INT16_MAX ? INT16_MAX : position.y;
+    uint16_t x = position.x;
+    uint8_t frame[WS_FRAME_POSITION_SIZE];
+    frame[0] = WS_FRAME_POSITION;
+    memcpy(&frame[1], &x, 2);
+    memcpy(&frame[3], &y, 2);
+    memcpy(&frame[5], &position.stepsPerRotation, 2);
+    frame[7] = position.penHeight;
+    frame[8] = position.moving ? 1 : 0;
+    _broadcast.publish(SLOT_POSITION, frame, sizeof(frame), true);
+}
+
+void Web::publishMetrics()
+{
+    char buff[JSON_METRICS_SIZE + 16];
+    JsonWriter json(buff, sizeof(buff));
+    json.beginObject().key("metrics");
+    writeMetrics(json);
+    json.endObject();
+    _broadcast.publish(SLOT_METRICS, (const uint8_t *)json.c_str(), json.length(), false);
+}
+
+static void writeHistogram(JsonWriter &json, const char *name, const Histogram &histogram)
+{
+    json.key(name)
+        .beginObject()
+        .member("count", histogram.count)
+        .member("totalMs", (unsigned long)(histogram.total / 1000))
+        .member("maxUs", histogram.max)
+        .key("buckets")
+        .beginArray();
+    // the empty ones at the end are left out
+    uint8_t used = METRICS_BUCKETS;
+    while (used && !histogram.buckets[used - 1])
+    {
+        used--;
+    }
+    for (uint8_t i = 0; i < used; i++)
+    {
+        json.value(histogram.buckets[i]);
+    }
+    json.endArray().endObject();
+}
+
+static void writeBroadcast(JsonWriter &json, const Broadcaster &broadcast)
+{
+    // read while loop() updates them, each is only ever one update behind
+    const BroadcastCounters &counters = broadcast.getCounters();
+    json.key("websocket")
+        .beginObject()
+        .member("maxRate", broadcast.getMaxRate())
+        .member("clients", broadcast.getClientCount())
+        .member("sent", counters.sent)
+        .member("coalesced", counters.coalesced)
+        .member("dropped", counters.dropped)
+        .member("closed", counters.closed)
+        .endObject();
+}
+
+void Web::writeMetrics(JsonWriter &json)
+{
+    // histogram bucket i counts durations of [2^i, 2^(i+1)) us
+    const PrintMetrics &metrics = _printer.getMetrics();
+    json.beginObject();
+    writeHistogram(json, "read", metrics.read);
+    writeHistogram(json, "parse", metrics.parse);
+    writeHistogram(json, "plan", metrics.plan);
+    writeHistogram(json, "motionWait", metrics.motionWait);
+    writeHistogram(json, "penWait", metrics.penWait);
+    json.key("stackFree")
+        .beginObject()
+        .member("print", metrics.printStack)
+        .member("read", metrics.readStack)
+        .member("pen", metrics.penStack)
+        .member("loop", _loopStack)
+        .endObject()
+        .key("heap")
+        .beginObject()
+        .member("free", ESP.getFreeHeap())
+        .member("minFree", ESP.getMinFreeHeap())
+        .member("largestBlock", (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT))
+        .endObject();
+    writeBroadcast(json, _broadcast);
+    json.endObject();
+}
+
+void Web::runQueue()
+{
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        if (_printer.isPrinting())
+        {
+            return;
+        }
+
+        if (_queuePrinting)
+        {
+            _queuePrinting = false;
+            changed = true;
+            if (_printer.getCompletedPrints() != _queueCompleted)
+            {
+                _queue.printed();
+            }
+            else
+            {
+                // stopped by hand, or it did not start: the operator decides
+                _queue.setRunning(false);
+            }
+        }
+
+        if (_queue.isRunning())
+        {
+            changed = true;
+            String path = _queue.size() ? findJob(_queue.at(0).name) : String();
+            bool confirm = _queueStarted && _queue.confirmsEachEgg();
+            _queueCompleted = _printer.getCompletedPrints();
+            if (path.length() && startJob(path, 0, confirm))
+            {
+                _queuePrinting = true;
+                _queueStarted = true;
+            }
+            else
+            {
+                // all done, or the job is gone
+                _queue.setRunning(false);
+            }
+        }
+    }
+
+    if (changed)
+    {
+        sendQueue();
+        sendStatus();
+    }
+}
+
+// "stream-begin <name>" starts printing what follows as binary frames,
+// "stream-end" after the last one, "stream-abort" stops the print
+void Web::handleStreamCommand(AsyncWebSocketClient *client, const char *data, size_t length)
+{
+    char command[WS_COMMAND_SIZE];
+    length = min(length, sizeof(command) - 1);
+    memcpy(command, data, length);
+    command[length] = 0;
+
+    if (length > 13 && strncmp("stream-begin ", command, 13) == 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_queueMutex);
+            if (_printer.isPrinting() || _queue.isRunning())
+            {
+                sendStream(client->id(), "error", "busy");
+                return;
+            }
+            uint32_t credit = _stream.begin();
+            _printer.printStream(_stream, command + 13);
+            _streamClient = client->id();
+            sendStream(client->id(), "credit", credit);
+        }
+        sendStatus();
+    }
+    else if (client->id() != _streamClient)
+    {
+        return;
+    }
+    else if (!strcmp("stream-end", command))
+    {
+        _stream.finish();
+        _streamClient = 0;
+    }
+    else if (!strcmp("stream-abort", command))
+    {
+        _streamClient = 0;
+        _printer.stop();
+    }
+}
+
+void Web::streamData(AsyncWebSocketClient *client, uint8_t *data, size_t length)
+{
+    if (client->id() != _streamClient || _stream.write(data, length))
+    {
+        return;
+    }
+    // sent past its credit, or the print was stopped meanwhile
+    _streamClient = 0;
+    _printer.stop();
+    sendStream(client->id(), "error", "refused");
+}
+
+void Web::sendStream(uint32_t client, const char *key, const char *value)
+{
+    char buff[60];
+    JsonWriter json(buff, sizeof(buff));
+    json.beginObject().key("stream").beginObject().member(key, value).endObject().endObject();
+    _ws.text(client, buff);
+}
+
+void Web::sendStream(uint32_t client, const char *key, uint32_t value)
+{
+    char buff[60];
+    JsonWriter json(buff, sizeof(buff));
+    json.beginObject().key("stream").beginObject().member(key, value).endObject().endObject();
+    _ws.text(client, buff);
+}
+
+void Web::writeStatus(JsonWriter &json)
+{
+    json.beginObject();
+    if (_printer.isPrinting())
+    {
+        if (_printer.isPaused())
+        {
+            json.member("status", "paused")
+                .member("waitingFor", _printer.getWaitingFor().c_str());
+        }
+        else
+        {
+            json.member("status", "printing");
+        }
+        if (_printer.isStreaming())
+        {
+            // as the client named it, there is no file
+            json.member("fileName", _printer.printingFileName());
+        }
+        else
+        {
+            json.key("fileName");
+            writeJobName(json, _printer.printingFileName(), _rootPath.length() + 1);
+        }
+        json.member("streaming", _printer.isStreaming())
+            .member("progress", _printer.getPrintedLines())
+            .member("percent", _printer.getProgressPercent())
+            .member("eta", _printer.getRemainingSeconds())
+            .member("duration", _printer.getEstimatedSeconds())
+            .member("readAhead", _printer.getReadAhead())
+            .member("readStalls", _printer.getReadStalls())
+            .member("merged", _printer.getMergedMoves())
+            .member("simplified", _printer.getSimplifiedMoves())
+            .member("confirmStart", _printer.isConfirmingStart());
+    }
+    else
+    {
+        json.member("status", "stopped");
+    }
+    json.member("feedOverride", _printer.getFeedOverride());
+    json.endObject();
+}
+
+void Web::publishStatus()
+{
+    char buff[JSON_STATUS_SIZE];
+    JsonWriter json(buff, sizeof(buff));
+    writeStatus(json);
+    _broadcast.publish(SLOT_STATUS, (const uint8_t *)json.c_str(), json.length(), false);
+}
+
+void Web::writeQueue(JsonWriter &json)
+{
+    json.beginObject()
+        .member("running", _queue.isRunning())
+        .member("confirm", _queue.confirmsEachEgg())
+        .key("jobs")
+        .beginArray();
+    for (uint8_t i = 0; i < _queue.size(); i++)
+    {
+        const PrintQueueEntry &entry = _queue.at(i);
+        json.beginObject()
+            .member("name", entry.name)
+            .member("copies", entry.copies)
+            .member("printed", entry.printed)
+            .endObject();
+    }
+    json.endArray().endObject();
+}
+
+void Web::publishQueue()
+{
+    char buff[JSON_QUEUE_SIZE + 16];
+    JsonWriter json(buff, sizeof(buff));
+    json.beginObject().key("queue");
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        writeQueue(json);
+    }
+    json.endObject();
+    _broadcast.publish(SLOT_QUEUE, (const uint8_t *)json.c_str(), json.length(), false);
+}
+
+String Web::findJob(const String &name)
+{
+    String path = _rootPath + "/" + name;
+    if (_fs.exists(path + extension))
+    {
+        return path + extension;
+    }
+    if (_fs.exists(path + binaryExtension))
+    {
+        return path + binaryExtension;
+    }
+    if (_fs.exists(path + compressedExtension))
+    {
+        return path + compressedExtension;
+    }
+    return String();
+}
+
+String Web::compiledPath(const String &path)
+{
+    return path.substring(0, path.length() - extension.length()) + compiledExtension;
+}
+
+bool Web::isCompiledJobValid(const String &path)
+{
+    File file = _fs.open(path);
+    if (!file)
+    {
+        return false;
+    }
 
-    _server.serveStatic("/", SPIFFS, "/", "public,max-age=3600,immutable");
-    _server.addHandler(&_ws);
-    _server.onNotFound([](AsyncWebServerRequest *req) {
-        req->send(SPIFFS, "/index.html");
-    });
+    uint8_t header[EGGBIN_HEADER_SIZE];
+    bool valid = file.read(header, sizeof(header)) == sizeof(header) &&
+                 isEggBinaryHeader(header, sizeof(header));
+    file.close();
+    if (!valid)
+    {
+        return false;
+    }
 
-    _ws.onEvent([this](AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
-        if (type == WS_EVT_CONNECT)
-        {
-            client->text(getStatusJson());
-        }
-        else if (type == WS_EVT_DATA)
-        {
-            if (len == 8 && strncmp("__ping__", (const char *)data, 8) == 0)
-            {
-                client->text("__pong__");
-            }
-        }
-    });
+    // compiled for other steps per rotation, the text job is used instead
+    MotionParameters params;
+    _printer.getParameters(params);
+    return getEggBinaryStepsPerRotation(header) == params.stepsPerRotation;
+}
 
-    _server.begin();
+// compiles a job that is already on the card, like an upload does
+void Web::compileFile(const String &path)
+{
+    _fs.remove(compiledPath(path));
+    _fs.remove(infoPath(path));
+    File file = _fs.open(path);
+    if (!file)
+    {
+        return;
+    }
 
-    _printer.onProgressChanged([this]() {
-        char buff[20];
-        snprintf(buff, sizeof(buff), "{\"progress\":%lu}", _printer.getPrintedLines());
-        _ws.textAll(buff);
-    });
+    MotionParameters params;
+    _printer.getParameters(params);
+    std::unique_ptr<JobUpload> upload(new JobUpload(_fs, infoPath(path), compiledPath(path), params));
+    uint8_t buffer[256];
+    size_t length;
+    bool valid = true;
+    while (valid && (length = file.read(buffer, sizeof(buffer))) > 0)
+    {
+        valid = upload->write(buffer, length);
+    }
+    file.close();
+    upload->end();
+}
 
-    _printer.onStatusChanged([this]() {
-        _ws.textAll(getStatusJson());
-    });
+bool Web::readInfo(const String &path, JobInfo &info)
+{
+    File file = _fs.open(infoPath(path));
+    if (!file)
+    {
+        return false;
+    }
+    bool valid = file.read((uint8_t *)&info, sizeof(JobInfo)) == sizeof(JobInfo);
+    file.close();
+    return valid;
 }
 
-String Web::getStatusJson()
+void Web::optimizeTaskHandler(void *arg)
 {
-    char buff[200];
-    if (_printer.isPrinting())
+    ((Web *)arg)->optimizeJob();
+    vTaskDelete(NULL);
+}
+
+void Web::optimizeJob()
+{
+    MotionParameters params;
+    _printer.getParameters(params);
+    String path = _rootPath + "/" + _optimizeName + extension;
+    String temp = path + tempExtension;
+
+    File in = _fs.open(_optimizeSource);
+    File out = _fs.open(temp, "w");
+    bool done = false;
+    if (in && out)
     {
-        String fileName = _printer.printingFileName();
-        fileName = fileName.substring(_rootPath.length() + 1, fileName.length() - extension.length());
-        if (_printer.isPaused())
-        {
-            snprintf(buff, sizeof(buff), "{\"status\":\"paused\",\"waitingFor\":\"%s\",\"fileName\":\"%s\",\"progress\":%lu}",
-                     _printer.getWaitingFor().c_str(),
-                     fileName.c_str(),
-                     _printer.getPrintedLines());
-        }
-        else
-        {
-            snprintf(buff, sizeof(buff), "{\"status\":\"printing\",\"fileName\":\"%s\",\"progress\":%lu}",
-                     fileName.c_str(),
-                     _printer.getPrintedLines());
-        }
+        FileSource source(in);
+        FileSink sink(out);
+        TravelOptimizer *optimizer = new TravelOptimizer(source, sink, params.stepsPerRotation);
+        done = optimizer->run() && sink.flush();
+        delete optimizer;
+    }
+    in.close();
+    out.close();
+
+    // an earlier copy is replaced
+    done = done && (!_fs.exists(path) || _fs.remove(path)) && _fs.rename(temp, path);
+    if (done)
+    {
+        compileFile(path);
     }
     else
     {
-        snprintf(buff, sizeof(buff), "{\"status\":\"stopped\"}");
+        _fs.remove(temp);
     }
+    _optimizeResult = done ? 1 : -1;
+}
 
-    return String(buff);
+String Web::infoPath(const String &path)
+{
+    return path.substring(0, path.lastIndexOf('.')) + infoExtension;
 }
 
 String Web::statusToString(wl_status_t status)
@@ -148,6 +1173,34 @@ String Web::statusToString(wl_status_t status)
     }
 }
 
+bool Web::startJob(const String &path, uint32_t line, bool confirm)
+{
+    // line numbers are the same in the compiled job
+    String job = path;
+    float seconds = 0;
+    if (job.endsWith(extension))
+    {
+        JobInfo info;
+        MotionParameters params;
+        _printer.getParameters(params);
+        if (readInfo(job, info) && hasSameTiming(info.parameters, params))
+        {
+            seconds = info.seconds;
+        }
+        if (isCompiledJobValid(compiledPath(job)))
+        {
+            job = compiledPath(job);
+        }
+    }
+    File file = _fs.open(job);
+    if (!file)
+    {
+        return false;
+    }
+    _printer.print(file, line, confirm, seconds);
+    return true;
+}
+
 void Web::handlePrint(AsyncWebServerRequest *req)
 {
     if (_printer.isPrinting())
@@ -156,33 +1209,272 @@ void Web::handlePrint(AsyncWebServerRequest *req)
         return;
     }
 
-    String path = _rootPath + "/" + req->url().substring(11) + extension;
-    if (_fs.exists(path))
+    String path = findJob(req->url().substring(11));
+    if (!path.length())
+    {
+        req->send(404);
+        return;
+    }
+
+    {
+        // the queue has the printer until it is stopped
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        if (_queue.isRunning())
+        {
+            req->send(409);
+            return;
+        }
+        uint32_t line = req->hasParam("line", true) ? req->getParam("line", true)->value().toInt() : 0;
+        startJob(path, line, false);
+    }
+    req->send(200);
+    sendStatus();
+}
+
+void Web::handleResume(AsyncWebServerRequest *req)
+{
+    if (req->method() == HTTP_DELETE)
     {
-        File file = _fs.open(path);
-        _printer.print(file);
+        _printer.clearCheckpoint();
         req->send(200);
-        _ws.textAll(getStatusJson());
+        return;
     }
-    else
+
+    PrintCheckpoint checkpoint;
+    if (!_printer.getCheckpoint(checkpoint) || !_fs.exists(checkpoint.path))
+    {
+        req->send(404);
+        return;
+    }
+
+    if (req->method() == HTTP_GET)
+    {
+        char buff[120];
+        JsonWriter json(buff, sizeof(buff));
+        json.beginObject().key("fileName");
+        writeJobName(json, checkpoint.path, _rootPath.length() + 1);
+        json.member("line", checkpoint.line).endObject();
+        sendJson(req, 200, json);
+        return;
+    }
+
+    if (_printer.isPrinting())
+    {
+        req->send(400);
+        return;
+    }
+
+    {
+        // the queue has the printer until it is stopped
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        if (_queue.isRunning())
+        {
+            req->send(409);
+            return;
+        }
+        File file = _fs.open(checkpoint.path);
+        _printer.resume(file, checkpoint);
+    }
+    req->send(200);
+    sendStatus();
+}
+
+void Web::handleOptimize(AsyncWebServerRequest *req)
+{
+    // text jobs only, binary ones have no segments to reorder
+    String name = req->url().substring(14);
+    String path = _rootPath + "/" + name + extension;
+    if (!_fs.exists(path))
     {
         req->send(404);
+        return;
+    }
+    if (_optimizing)
+    {
+        req->send(409);
+        return;
     }
+
+    _optimizing = true;
+    _optimizeSource = path;
+    _optimizeName = name + optimizedSuffix;
+    xTaskCreatePinnedToCore(optimizeTaskHandler, "Optimize", 6000, this, OPTIMIZE_TASK_PRIORITY, NULL, 0);
+
+    char buff[120];
+    JsonWriter json(buff, sizeof(buff));
+    json.beginObject().member("name", _optimizeName.c_str()).endObject();
+    sendJson(req, 202, json);
 }
 
-void Web::handleWifiScan(AsyncWebServerRequest *req)
+void Web::handleQueue(AsyncWebServerRequest *req)
 {
-    int count = WiFi.scanNetworks();
-    String json = "[";
-    for (auto i = 0; i < count; i++)
+    if (req->method() == HTTP_PATCH)
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        if (req->hasParam("confirm", true))
+        {
+            _queue.setConfirmsEachEgg(req->getParam("confirm", true)->value().equals("true"));
+        }
+        if (req->hasParam("running", true))
+        {
+            // stopping lets the egg printing now finish
+            bool running = req->getParam("running", true)->value().equals("true");
+            if (running && !_queue.isRunning())
+            {
+                _queueStarted = false;
+            }
+            _queue.setRunning(running);
+        }
+    }
+
+    char buff[JSON_QUEUE_SIZE];
+    JsonWriter json(buff, sizeof(buff));
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        writeQueue(json);
+    }
+    sendJson(req, 200, json);
+    if (req->method() == HTTP_PATCH)
+    {
+        sendQueue();
+    }
+}
+
+void Web::handleQueueEntry(AsyncWebServerRequest *req)
+{
+    // POST /api/queue/<job> adds a job, PATCH and DELETE /api/queue/<index>
+    // change an entry
+    String rest = req->url().substring(11);
+    int code = 200;
+    if (req->method() == HTTP_POST)
+    {
+        long copies = req->hasParam("copies", true) ? req->getParam("copies", true)->value().toInt() : 1;
+        if (!findJob(rest).length())
+        {
+            code = 404;
+        }
+        else if (copies < 1 || copies > UINT16_MAX)
+        {
+            code = 400;
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(_queueMutex);
+            code = _queue.add(rest.c_str(), copies) ? 200 : 409;
+        }
+    }
+    else
+    {
+        bool isIndex = rest.length() > 0;
+        for (size_t i = 0; i < rest.length(); i++)
+        {
+            isIndex = isIndex && isDigit(rest[i]);
+        }
+        long index = rest.toInt();
+
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        if (!isIndex || index >= _queue.size())
+        {
+            code = 404;
+        }
+        else if (req->method() == HTTP_DELETE)
+        {
+            // the egg printing now stays first until it is done
+            code = index == 0 && _queuePrinting ? 409 : _queue.remove(index) ? 200 : 400;
+        }
+        else
+        {
+            if (req->hasParam("copies", true) &&
+                !_queue.setCopies(index, req->getParam("copies", true)->value().toInt()))
+            {
+                code = 400;
+            }
+            if (code == 200 && req->hasParam("position", true))
+            {
+                long position = req->getParam("position", true)->value().toInt();
+                if (_queuePrinting && (index == 0 || position == 0))
+                {
+                    code = 409;
+                }
+                else if (position < 0 || !_queue.move(index, position))
+                {
+                    code = 400;
+                }
+            }
+        }
+    }
+
+    req->send(code);
+    if (code == 200)
+    {
+        sendQueue();
+    }
+}
+
+void Web::handleOverride(AsyncWebServerRequest *req)
+{
+    if (req->hasParam("feed", true))
+    {
+        _printer.setFeedOverride(req->getParam("feed", true)->value().toInt());
+    }
+
+    char buff[40];
+    JsonWriter json(buff, sizeof(buff));
+    json.beginObject()
+        .member("feed", _printer.getFeedOverride())
+        .endObject();
+    sendJson(req, 200, json);
+}
+
+// a rate parameter of /api/websocket: false if it is there and out of range
+static bool readRate(AsyncWebServerRequest *req, const char *name, long &rate)
+{
+    if (!req->hasParam(name, true))
+    {
+        return true;
+    }
+    rate = req->getParam(name, true)->value().toInt();
+    return rate >= 0 && rate <= 50;
+}
+
+void Web::handleWebSocket(AsyncWebServerRequest *req)
+{
+    long maxRate = -1, positionRate = -1;
+    if (!readRate(req, "maxRate", maxRate) || !readRate(req, "positionRate", positionRate))
     {
-        char network[150];
-        snprintf(network, sizeof(network), "{\"ssid\":\"%s\",\"encryptionType\":%d,\"rssi\":%d,\"channel\":%d,\"bssid\":\"%s\"}%s",
-                 WiFi.SSID(i).c_str(), WiFi.encryptionType(i), WiFi.RSSI(i), WiFi.channel(i), WiFi.BSSIDstr(i).c_str(), i == count - 1 ? "" : ",");
-        json += network;
+        req->send(400);
+        return;
+    }
+    if (maxRate >= 0)
+    {
+        _broadcast.setMaxRate(maxRate);
     }
-    json += "]";
-    req->send(200, "application/json", json);
+    if (positionRate >= 0)
+    {
+        _positionRate = positionRate;
+    }
+
+    char buff[180];
+    JsonWriter json(buff, sizeof(buff));
+    json.beginObject()
+        .member("positionRate", _positionRate.load());
+    writeBroadcast(json, _broadcast);
+    json.endObject();
+    sendJson(req, 200, json);
+}
+
+void Web::handleMetrics(AsyncWebServerRequest *req)
+{
+    char buff[JSON_METRICS_SIZE];
+    JsonWriter json(buff, sizeof(buff));
+    writeMetrics(json);
+    sendJson(req, 200, json);
+}
+
+void Web::handleWifiScan(AsyncWebServerRequest *req)
+{
+    int count = WiFi.scanNetworks();
+    sendJsonArray(req, new NetworkListSource(count < 0 ? 0 : count));
 }
 
 void Web::handleWifiConnect(AsyncWebServerRequest *req)
@@ -212,9 +1504,10 @@ void Web::handleWifiConnect(AsyncWebServerRequest *req)
         }
         else
         {
-            char json[150];
-            snprintf(json, sizeof(json), "{\"error\": \"%s\"}", statusToString(result).c_str());
-            req->send(400, "application/json", json);
+            char buff[100];
+            JsonWriter json(buff, sizeof(buff));
+            json.beginObject().member("error", statusToString(result).c_str()).endObject();
+            sendJson(req, 400, json);
         }
     }
     req->send(400);
@@ -222,16 +1515,14 @@ void Web::handleWifiConnect(AsyncWebServerRequest *req)
 
 void Web::handleWifiStatus(AsyncWebServerRequest *req)
 {
-    char json[500];
-    snprintf(json, sizeof(json), "{"
-                                 "\"status\":\"%s\","
-                                 "\"ssid\":\"%s\","
-                                 "\"bssid\":\"%s\""
-                                 "}",
-             statusToString(WiFi.status()).c_str(),
-             WiFi.SSID().c_str(),
-             WiFi.BSSIDstr().c_str());
-    req->send(200, "application/json", json);
+    char buff[JSON_RESPONSE_SIZE];
+    JsonWriter json(buff, sizeof(buff));
+    json.beginObject()
+        .member("status", statusToString(WiFi.status()).c_str())
+        .member("ssid", WiFi.SSID().c_str())
+        .member("bssid", WiFi.BSSIDstr().c_str())
+        .endObject();
+    sendJson(req, 200, json);
 }
 
 void Web::handlePrinterCommand(AsyncWebServerRequest *req)
@@ -274,9 +1565,17 @@ void Web::handleUpdateMotionParams(AsyncWebServerRequest *req)
     {
         params.drawingSpeed = req->getParam("drawingSpeed", true)->value().toInt();
     }
-    if (req->hasParam("penMoveDelay", true))
+    if (req->hasParam("penUpDelay", true))
+    {
+        params.penUpDelay = req->getParam("penUpDelay", true)->value().toInt();
+    }
+    if (req->hasParam("penDownDelay", true))
+    {
+        params.penDownDelay = req->getParam("penDownDelay", true)->value().toInt();
+    }
+    if (req->hasParam("penOverlap", true))
     {
-        params.penMoveDelay = req->getParam("penMoveDelay", true)->value().toInt();
+        params.penOverlap = req->getParam("penOverlap", true)->value().toInt();
     }
     if (req->hasParam("travelSpeed", true))
     {
@@ -294,6 +1593,34 @@ void Web::handleUpdateMotionParams(AsyncWebServerRequest *req)
     {
         params.reverseRotation = req->getParam("reverseRotation", true)->value().equals("true");
     }
+    if (req->hasParam("acceleration", true))
+    {
+        params.acceleration = req->getParam("acceleration", true)->value().toInt();
+    }
+    if (req->hasParam("junctionDeviation", true))
+    {
+        params.junctionDeviation = req->getParam("junctionDeviation", true)->value().toInt();
+    }
+    if (req->hasParam("startSpeed", true))
+    {
+        params.startSpeed = req->getParam("startSpeed", true)->value().toInt();
+    }
+    if (req->hasParam("wrapDrawing", true))
+    {
+        params.wrapDrawing = req->getParam("wrapDrawing", true)->value().equals("true");
+    }
+    if (req->hasParam("pathTolerance", true))
+    {
+        params.pathTolerance = req->getParam("pathTolerance", true)->value().toInt();
+    }
+    if (req->hasParam("maxDrawingSpeed", true))
+    {
+        params.maxDrawingSpeed = req->getParam("maxDrawingSpeed", true)->value().toInt();
+    }
+    if (req->hasParam("straightRun", true))
+    {
+        params.straightRun = req->getParam("straightRun", true)->value().toInt();
+    }
     _printer.setParameters(params);
     req->send(200);
 }
@@ -303,16 +1630,28 @@ void Web::handleGetMotionParams(AsyncWebServerRequest *req)
     MotionParameters params;
     _printer.getParameters(params);
 
-    char response[200];
-    snprintf(response, sizeof(response),
-             "{\"penUpPercent\":%d,\"penDownPercent\":%d,\"drawingSpeed\":%d,\"penMoveDelay\":%d,"
-             "\"travelSpeed\":%d,\"stepsPerRotation\":%d,\"reversePen\":%s,\"reverseRotation\":%s}",
-             params.penUpPercent, params.penDownPercent, params.drawingSpeed, params.penMoveDelay,
-             params.travelSpeed, params.stepsPerRotation,
-             params.reversePen ? "true" : "false",
-             params.reverseRotation ? "true" : "false");
-
-    req->send(200, "application/json", response);
+    char buff[JSON_RESPONSE_SIZE];
+    JsonWriter json(buff, sizeof(buff));
+    json.beginObject()
+        .member("penUpPercent", params.penUpPercent)
+        .member("penDownPercent", params.penDownPercent)
+        .member("drawingSpeed", params.drawingSpeed)
+        .member("penUpDelay", params.penUpDelay)
+        .member("penDownDelay", params.penDownDelay)
+        .member("penOverlap", params.penOverlap)
+        .member("travelSpeed", params.travelSpeed)
+        .member("stepsPerRotation", params.stepsPerRotation)
+        .member("reversePen", params.reversePen)
+        .member("reverseRotation", params.reverseRotation)
+        .member("acceleration", params.acceleration)
+        .member("junctionDeviation", params.junctionDeviation)
+        .member("startSpeed", params.startSpeed)
+        .member("wrapDrawing", params.wrapDrawing)
+        .member("pathTolerance", params.pathTolerance)
+        .member("maxDrawingSpeed", params.maxDrawingSpeed)
+        .member("straightRun", params.straightRun)
+        .endObject();
+    sendJson(req, 200, json);
 }
 
 void Web::handleFilesList(AsyncWebServerRequest *req)
@@ -324,30 +1663,27 @@ void Web::handleFilesList(AsyncWebServerRequest *req)
         return;
     }
 
-    String output = "[";
-    auto skip = _rootPath.length() + 1;
-    while (File file = dir.openNextFile())
-    {
-        auto fileName = String(file.name());
-
-        if (!fileName.endsWith(extension))
-            continue;
-
-        if (output != "[")
-        {
-            output += ',';
-        }
-        output += "{\"name\":\"";
-        output += fileName.substring(skip, fileName.length() - extension.length());
-        output += "\"}";
-    }
-    output += "]";
-    req->send(200, "application/json", output);
+    MotionParameters params;
+    _printer.getParameters(params);
+    uint32_t offset = req->hasParam("offset") ? req->getParam("offset")->value().toInt() : 0;
+    uint32_t limit = req->hasParam("limit") ? req->getParam("limit")->value().toInt() : 0;
+    sendJsonArray(req, new FileListSource(_fs, dir, _rootPath.length() + 1, offset, limit, params));
 }
 
 void Web::handleFilesUploadResponse(AsyncWebServerRequest *req)
 {
-    if (req->_tempFile)
+    if (req->_tempObject)
+    {
+        const UploadError *error = (const UploadError *)req->_tempObject;
+        char buff[JSON_RESPONSE_SIZE];
+        JsonWriter json(buff, sizeof(buff));
+        json.beginObject()
+            .member("error", error->message)
+            .member("line", error->line)
+            .endObject();
+        sendJson(req, 422, json);
+    }
+    else if (req->_tempFile)
     {
         req->_tempFile.close();
         req->send(201);
@@ -362,33 +1698,103 @@ void Web::handleFileUploadBody(AsyncWebServerRequest *request, String filename,
 {
     if (!index)
     {
-        String path = _rootPath + "/" + filename + extension;
+        // binary and compressed jobs keep their own extension
+        String path = _rootPath + "/" + filename;
+        if (!filename.endsWith(binaryExtension) && !filename.endsWith(compressedExtension))
+        {
+            path += extension;
+        }
         if (!_fs.exists(path))
         {
             auto file = _fs.open(path, "w");
             request->_tempFile = file;
+
+            bool compile = !request->hasParam("compile") || request->getParam("compile")->value() != "0";
+            // one upload is checked at a time, a new one takes over
+            delete _upload;
+            _upload = NULL;
+            _uploadRequest = NULL;
+            if (file && path.endsWith(extension))
+            {
+                MotionParameters params;
+                _printer.getParameters(params);
+                _upload = new JobUpload(_fs, infoPath(path), compile ? compiledPath(path) : String(), params);
+                _uploadRequest = request;
+            }
         }
     }
+
+    bool checked = _upload && request == _uploadRequest;
     if (len && request->_tempFile)
     {
         request->_tempFile.write(data, len);
+        if (checked && !_upload->write(data, len))
+        {
+            rejectUpload(request);
+            return;
+        }
+    }
+    if (final && checked)
+    {
+        if (request->_tempFile && !_upload->end())
+        {
+            // the last line, without a new line after it, is bad
+            rejectUpload(request);
+            return;
+        }
+        delete _upload;
+        _upload = NULL;
+        _uploadRequest = NULL;
     }
 }
 
+// a bad line: the job is not kept and the response says where
+void Web::rejectUpload(AsyncWebServerRequest *request)
+{
+    UploadError *error = (UploadError *)malloc(sizeof(UploadError));
+    if (error)
+    {
+        _upload->getError(*error);
+        // freed with the request
+        request->_tempObject = error;
+    }
+    delete _upload;
+    _upload = NULL;
+    _uploadRequest = NULL;
+
+    String path = request->_tempFile.name();
+    request->_tempFile.close();
+    request->_tempFile = File();
+    _fs.remove(path);
+}
+
 void Web::handleFileGetDelete(AsyncWebServerRequest *req)
 {
-    String path = _rootPath + "/" + req->url().substring(10) + extension;
-    if (req->method() == HTTP_GET)
+    String path = findJob(req->url().substring(10));
+    if (!path.length())
+    {
+        return req->send(404);
+    }
+
+    if (req->method() == HTTP_GET && path.endsWith(compressedExtension))
+    {
+        // the browser inflates it, so the client gets the text job
+        AsyncWebServerResponse *response = req->beginResponse(_fs, path, "text/plain");
+        response->addHeader("Content-Encoding", "gzip");
+        req->send(response);
+    }
+    else if (req->method() == HTTP_GET)
     {
         req->send(_fs, path);
     }
     else
     {
-        if (!_fs.exists(path))
+        _fs.remove(path);
+        if (path.endsWith(extension))
         {
-            return req->send(404);
+            _fs.remove(compiledPath(path));
+            _fs.remove(infoPath(path));
         }
-        _fs.remove(path);
         req->send(200);
     }
 }
@@ -408,9 +1814,10 @@ void Web::handleConfigUpdate(AsyncWebServerRequest *request, uint8_t *data, size
 
 void Web::handleUpdateResponse(AsyncWebServerRequest *req)
 {
-    char json[150];
-    snprintf(json, sizeof(json), "{\"status\":\"%s\"}", Update.errorString());
-    req->send(Update.hasError() ? 500 : 200, "application/json", json);
+    char buff[150];
+    JsonWriter json(buff, sizeof(buff));
+    json.beginObject().member("status", Update.errorString()).endObject();
+    sendJson(req, Update.hasError() ? 500 : 200, json);
 
     if (Update.hasError())
     {
@@ -4,20 +4,91 @@
 #include <ESPAsyncWebServer.h>
 #include <Arduino.h>
 #include <FS.h>
+#include <atomic>
+#include <mutex>
 
+#include "broadcaster.h"
+#include "fsstream.h"
+#include "jobcompiler.h"
+#include "jobvalidator.h"
+#include "jsonwriter.h"
 #include "printer.h"
+#include "printqueue.h"
+#include "spsc.h"
+#include "streambuffer.h"
+
+// updates a second to each websocket client, until changed in /api/websocket
+#define WS_MAX_RATE 4
+// pen position samples a second, until changed in /api/websocket
+#define WS_POSITION_RATE 4
+
+struct JobInfo;
+class JobUpload;
+
+// the websocket's clients, as the broadcaster sees them
+class WebSocketSink : public BroadcastSink
+{
+public:
+    WebSocketSink(AsyncWebSocket &ws) : _ws(ws) {}
+    SinkState getState(uint32_t client) override;
+    void send(uint32_t client, const uint8_t *data, size_t length, bool binary) override;
+    void close(uint32_t client) override;
+
+private:
+    AsyncWebSocket &_ws;
+};
 
 class Web
 {
 public:
     Web(FS &fs, Printer &printer, String rootPath = "/eggbot", uint16_t port = 80);
     void begin();
+    // sends the printer events, call from the loop task
+    void loop();
 
 private:
-    String getStatusJson();
+    void writeQueue(JsonWriter &json);
+    // to every client, from the next loop()
+    void sendQueue() { _queueChanged = true; }
+    // starts the next queued job when the printer is free, call from loop()
+    void runQueue();
+    bool startJob(const String &path, uint32_t line, bool confirm);
+    // a job printed as it arrives on the websocket
+    void handleStreamCommand(AsyncWebSocketClient *client, const char *data, size_t length);
+    void streamData(AsyncWebSocketClient *client, uint8_t *data, size_t length);
+    // {"stream":{key:value}} to one client
+    void sendStream(uint32_t client, const char *key, const char *value);
+    void sendStream(uint32_t client, const char *key, uint32_t value);
+    void writeStatus(JsonWriter &json);
+    void writeMetrics(JsonWriter &json);
+    // to every client, from the next loop()
+    void sendStatus() { _statusChanged = true; }
+    // into the broadcaster, loop() only
+    void publishProgress(const PrinterEvent &progress);
+    // if it moved since the last one
+    void publishPosition();
+    void publishStatus();
+    void publishQueue();
+    void publishMetrics();
+    String findJob(const String &name);
+    String compiledPath(const String &path);
+    String infoPath(const String &path);
+    bool isCompiledJobValid(const String &path);
+    void compileFile(const String &path);
+    // of a text job, written at upload
+    bool readInfo(const String &path, JobInfo &info);
+    static void optimizeTaskHandler(void *arg);
+    void optimizeJob();
 
     void handlePrint(AsyncWebServerRequest *req);
+    void handleResume(AsyncWebServerRequest *req);
     void handlePrinterCommand(AsyncWebServerRequest *req);
+    void handleOptimize(AsyncWebServerRequest *req);
+    void handleQueue(AsyncWebServerRequest *req);
+    void handleQueueEntry(AsyncWebServerRequest *req);
+    void handleMetrics(AsyncWebServerRequest *req);
+    void handleOverride(AsyncWebServerRequest *req);
+    void handleWebSocket(AsyncWebServerRequest *req);
 
     void handleWifiScan(AsyncWebServerRequest *req);
     void handleWifiConnect(AsyncWebServerRequest *req);
@@ -29,6 +100,7 @@ private:
     void handleFilesList(AsyncWebServerRequest *req);
     void handleFilesUploadResponse(AsyncWebServerRequest *req);
     void handleFileUploadBody(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final);
+    void rejectUpload(AsyncWebServerRequest *request);
     void handleFileGetDelete(AsyncWebServerRequest *req);
 
     void handleConfigGet(AsyncWebServerRequest *req);
@@ -44,7 +116,49 @@ private:
     String _rootPath;
     AsyncWebServer _server;
     AsyncWebSocket _ws;
+    // status, queue, progress and metrics go to the clients through it,
+    // used from loop() only
+    WebSocketSink _sink{_ws};
+    Broadcaster _broadcast{_sink, WS_MAX_RATE};
+    // clients connected since the last loop(), from the websocket events
+    SpscQueue<uint32_t, 16> _joined;
+    // set from any task, loop() publishes them
+    std::atomic<bool> _statusChanged{false};
+    std::atomic<bool> _queueChanged{false};
+    // samples a second, 0 for none
+    std::atomic<uint8_t> _positionRate{WS_POSITION_RATE};
+    uint32_t _lastPosition = 0;
+    MachinePosition _position = {};
     fs::File uploadFile;
+
+    // the text job being uploaded, checked as it arrives, and its request
+    JobUpload *_upload = NULL;
+    AsyncWebServerRequest *_uploadRequest = NULL;
+
+    // one job is optimised at a time, in the background
+    std::atomic<bool> _optimizing{false};
+    // set by the optimize task when done (1) or failed (-1), loop() announces it
+    std::atomic<int8_t> _optimizeResult{0};
+    String _optimizeSource;
+    String _optimizeName;
+
+    // changed from the request handlers and loop()
+    std::mutex _queueMutex;
+    PrintQueue _queue;
+    // the queue's first entry is printing, the printer had completed this many
+    bool _queuePrinting = false;
+    uint32_t _queueCompleted = 0;
+    // the first egg after starting the queue needs no confirmation
+    bool _queueStarted = false;
+
+    // the one streamed job, and the client sending it (0 for none)
+    StreamBuffer _stream;
+    std::atomic<uint32_t> _streamClient{0};
+
+    // metrics go out on the websocket this often while printing
+    uint32_t _lastMetrics = 0;
+    // least free stack seen of the loop task, bytes
+    uint32_t _loopStack = 0;
 };
 
 #endif
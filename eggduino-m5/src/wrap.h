@@ -0,0 +1,45 @@
+#ifndef WRAP_H
+#define WRAP_H
+
+#include <stdint.h>
+
+// The egg turns without end, so a job's rotation only matters modulo
+// stepsPerRotation. Keeps the whole turns between the job's (absolute)
+// rotation and the machine's, and moves them to take the shorter way round.
+class RotationWrap
+{
+public:
+    RotationWrap() : stepsPerRotation(0), offset(0) {}
+
+    void begin(uint16_t stepsPerRotation)
+    {
+        this->stepsPerRotation = stepsPerRotation;
+        offset = 0;
+    }
+
+    // the machine rotation for the job rotation x. With shortest, whole turns
+    // are added or taken so it is at most half a turn away from the machine
+    // rotation from; otherwise the turns stay as they are
+    int32_t map(int32_t x, int32_t from, bool shortest)
+    {
+        if (shortest && stepsPerRotation)
+        {
+            int32_t ahead = x + offset - from + stepsPerRotation / 2;
+            int32_t turns = ahead >= 0 ? ahead / stepsPerRotation : -((stepsPerRotation - 1 - ahead) / stepsPerRotation);
+            offset -= turns * stepsPerRotation;
+        }
+        return x + offset;
+    }
+
+    // the job rotation the machine rotation x stands for
+    int32_t unmap(int32_t x) const { return x - offset; }
+
+    // the machine position was reset to the job's
+    void reset() { offset = 0; }
+
+private:
+    uint16_t stepsPerRotation;
+    int32_t offset;
+};
+
+#endif
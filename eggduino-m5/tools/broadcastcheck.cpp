@@ -0,0 +1,202 @@
+// Runs the websocket broadcaster against simulated clients that drain their
+// queues at different speeds, one of them not at all, with progress
+// published far faster than anyone needs it. Checks no client is sent more
+// than the rate allows, messages never go backwards, every client that
+// keeps up ends with the latest of each, and the stalled one is closed.
+// Compares the frames sent with sending every update to every client.
+//
+// g++ -std=c++11 -O2 -Isrc tools/broadcastcheck.cpp src/broadcaster.cpp -o broadcastcheck
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "broadcaster.h"
+
+// AsyncWebSocket's WS_MAX_QUEUED_MESSAGES
+#define QUEUE_SIZE 32
+#define MAX_RATE 4
+#define SECONDS 60
+// published every this many ms
+#define PROGRESS_INTERVAL 10
+#define STATUS_INTERVAL 2000
+#define QUEUE_INTERVAL 7000
+
+struct SimClient
+{
+    SimClient(const char *name, uint32_t drainRate)
+        : name(name), drainRate(drainRate), id(0), gone(false), queued(0), received(0),
+          latest(), lastReceived(0), tooSoon(0), backwards(0), closedAt(0)
+    {
+    }
+
+    const char *name;
+    // frames taken off the queue a second, 0 never
+    uint32_t drainRate;
+    uint32_t id;
+    bool gone;
+    uint32_t queued;
+    uint32_t received;
+    // the latest message seen of each slot, and when it came
+    uint32_t latest[BROADCAST_SLOTS];
+    uint32_t lastReceived;
+    // sends closer together than the rate allows
+    uint32_t tooSoon;
+    uint32_t backwards;
+    uint32_t closedAt;
+};
+
+class SimSink : public BroadcastSink
+{
+public:
+    std::vector<SimClient> clients;
+    uint32_t now = 0;
+
+    SimClient *find(uint32_t id)
+    {
+        for (SimClient &client : clients)
+        {
+            if (client.id == id)
+            {
+                return &client;
+            }
+        }
+        return NULL;
+    }
+
+    SinkState getState(uint32_t id) override
+    {
+        SimClient *client = find(id);
+        if (!client || client->gone)
+        {
+            return SINK_GONE;
+        }
+        return client->queued >= QUEUE_SIZE ? SINK_FULL : SINK_READY;
+    }
+
+    void send(uint32_t id, const uint8_t *data, size_t, bool) override
+    {
+        SimClient *client = find(id);
+        uint32_t value;
+        memcpy(&value, data + 1, sizeof(value));
+        uint8_t slot = data[0];
+        if (value < client->latest[slot])
+        {
+            client->backwards++;
+        }
+        // one flush sends several slots at once, but never sooner than the rate
+        if (client->received && now != client->lastReceived && now - client->lastReceived < 1000 / MAX_RATE)
+        {
+            client->tooSoon++;
+        }
+        client->latest[slot] = value;
+        client->lastReceived = now;
+        client->queued++;
+        client->received++;
+    }
+
+    void close(uint32_t id) override
+    {
+        SimClient *client = find(id);
+        client->gone = true;
+        client->closedAt = now;
+    }
+};
+
+static void publish(Broadcaster &broadcast, uint8_t slot, uint32_t value, size_t length)
+{
+    // like the real messages, a type and a counter at the start
+    uint8_t message[400] = {0};
+    message[0] = slot;
+    memcpy(&message[1], &value, sizeof(value));
+    broadcast.publish(slot, message, length, slot == 0);
+}
+
+int main()
+{
+    SimSink sink;
+    sink.clients = {
+        {"lan", 1000},
+        {"wifi", 60},
+        {"weak phone", 3},
+        {"stalled", 0},
+    };
+    Broadcaster broadcast(sink, MAX_RATE);
+    uint32_t id = 1;
+    for (SimClient &client : sink.clients)
+    {
+        client.id = id++;
+        broadcast.addClient(client.id);
+    }
+
+    uint32_t published[BROADCAST_SLOTS] = {0};
+    uint32_t allUpdates = 0;
+    uint32_t end = SECONDS * 1000;
+    for (uint32_t ms = 1; ms <= end + 2000; ms++)
+    {
+        sink.now = ms;
+        // the last two seconds are quiet, everybody can catch up
+        if (ms <= end)
+        {
+            if (ms % PROGRESS_INTERVAL == 0)
+            {
+                publish(broadcast, 0, ++published[0], 10);
+            }
+            if (ms % STATUS_INTERVAL == 0)
+            {
+                publish(broadcast, 1, ++published[1], 300);
+            }
+            if (ms % QUEUE_INTERVAL == 0)
+            {
+                publish(broadcast, 2, ++published[2], 200);
+            }
+        }
+        for (SimClient &client : sink.clients)
+        {
+            if (client.drainRate && client.queued && ms % (1000 / client.drainRate) == 0)
+            {
+                client.queued--;
+            }
+        }
+        broadcast.flush(ms);
+    }
+    allUpdates = (published[0] + published[1] + published[2]) * sink.clients.size();
+
+    bool ok = true;
+    printf("%-12s %8s %10s %9s %s\n", "client", "drain/s", "received", "latest", "");
+    for (SimClient &client : sink.clients)
+    {
+        bool current = !memcmp(client.latest, published, sizeof(published));
+        printf("%-12s %8u %10u %9s", client.name, client.drainRate, client.received,
+               current ? "yes" : "no");
+        if (client.gone)
+        {
+            printf(" closed at %.1f s", client.closedAt / 1000.0);
+        }
+        printf("\n");
+
+        if (client.tooSoon || client.backwards)
+        {
+            printf("  FAILED: %u sent too soon, %u went backwards\n", client.tooSoon, client.backwards);
+            ok = false;
+        }
+        // only the stalled one is closed
+        bool stalled = !client.drainRate;
+        if (stalled != client.gone || (!stalled && !current))
+        {
+            printf("  FAILED: %s\n", stalled ? "not closed" : "missed the latest messages");
+            ok = false;
+        }
+    }
+
+    const BroadcastCounters &counters = broadcast.getCounters();
+    printf("sent %u frames (%u sending every update to everyone), coalesced %u, dropped %u, closed %u\n",
+           counters.sent, allUpdates, counters.coalesced, counters.dropped, counters.closed);
+    if (broadcast.getClientCount() != 3)
+    {
+        printf("FAILED: %u clients left\n", broadcast.getClientCount());
+        ok = false;
+    }
+    printf(ok ? "ok\n" : "FAILED\n");
+    return ok ? 0 : 2;
+}
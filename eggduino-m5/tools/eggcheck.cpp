@@ -0,0 +1,72 @@
+// Checks jobs the way an upload does: every line as the bytes arrive in
+// network sized chunks, stopping at the first line the printer would not
+// read as written. Prints the stats the upload keeps for the file list,
+// or the bad line. Exits with 2 if any job is bad.
+//
+// g++ -std=c++11 -O2 -Isrc -Itools tools/eggcheck.cpp src/command.cpp src/estimator.cpp src/jobvalidator.cpp src/pathfilter.cpp src/planner.cpp src/strokespeed.cpp -o eggcheck
+
+#include <stdio.h>
+#include <string.h>
+
+#include "estimator.h"
+#include "hostio.h"
+#include "jobvalidator.h"
+
+// about one TCP segment, like upload chunks
+#define CHUNK_SIZE 1436
+
+static bool check(const char *path)
+{
+    std::vector<uint8_t> data;
+    if (!readFile(path, data))
+    {
+        return false;
+    }
+
+    MotionParameters params;
+    getDefaultParameters(params);
+    JobEstimator estimator(params);
+    JobValidator validator(params.stepsPerRotation, &estimator);
+    bool valid = true;
+    for (size_t offset = 0; valid && offset < data.size(); offset += CHUNK_SIZE)
+    {
+        size_t length = data.size() - offset < CHUNK_SIZE ? data.size() - offset : CHUNK_SIZE;
+        valid = validator.write(data.data() + offset, length);
+    }
+    valid = valid && validator.end();
+    if (!valid)
+    {
+        printf("%s:%u: %s\n", path, validator.getErrorLine(), validator.getError());
+        return false;
+    }
+
+    const JobStats &stats = validator.getStats();
+    printf("%s: %u lines, %u pen lifts, %.0f s\n", path, stats.lines, stats.penLifts, estimator.end());
+    printf("  bounds    %.1f %.1f to %.1f %.1f degrees\n", stats.minX, stats.minY, stats.maxX, stats.maxY);
+    printf("  distance  %.0f drawing, %.0f travel degrees\n", stats.drawDistance, stats.travelDistance);
+    if (stats.layerCount)
+    {
+        printf("  layers   ");
+        for (uint16_t i = 0; i < stats.layerCount && i < JOB_STATS_LAYERS; i++)
+        {
+            printf(" %s", stats.layers[i]);
+        }
+        printf(stats.layerCount > JOB_STATS_LAYERS ? " (%u in all)\n" : "\n", stats.layerCount);
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: eggcheck job.egg...\n");
+        return 1;
+    }
+    bool ok = true;
+    for (int i = 1; i < argc; i++)
+    {
+        ok = check(argv[i]) && ok;
+    }
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,220 @@
+// Converts text .egg jobs to the binary .eggb format and checks that both
+// produce exactly the same commands (in steps) when printed. compile does
+// what the firmware does at upload: it feeds the text in chunks to the
+// JobCompiler and produces the .eggc step cache.
+//
+// g++ -std=c++11 -O2 -Isrc tools/eggconv.cpp src/command.cpp src/jobreader.cpp src/eggbin.cpp src/jobcompiler.cpp src/estimator.cpp src/pathfilter.cpp src/planner.cpp src/strokespeed.cpp -o eggconv
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hostjob.h"
+#include "jobcompiler.h"
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: eggconv encode in.egg out.eggb [--steps N]  convert a text job\n"
+            "       eggconv compile in.egg out.eggc [--steps N] compile like an upload does\n"
+            "       eggconv verify in.egg [--steps N]           check the binary round trip\n"
+            "       eggconv dump job [--steps N]                print commands in steps\n"
+            "  --steps N   steps per rotation (6400)\n");
+    exit(1);
+}
+
+static bool sameCommand(const Command &a, const Command &b)
+{
+    if (a.type != b.type)
+    {
+        return false;
+    }
+    switch (a.type)
+    {
+    case CMD_MOVE:
+        return a.x == b.x && a.y == b.y;
+    case CMD_PROGRESS:
+        return a.value == b.value;
+    case CMD_WAIT:
+        return strcmp(a.text, b.text) == 0;
+    default:
+        return true;
+    }
+}
+
+static void printCommand(unsigned long line, const Command &cmd)
+{
+    static const char *names[] = {"-", "P0", "P1", "M1", "M0", "Z", "S", "H", "T"};
+    printf("%lu %s", line, names[cmd.type]);
+    if (cmd.type == CMD_MOVE)
+        printf(" %d %d", cmd.x, cmd.y);
+    else if (cmd.type == CMD_PROGRESS)
+        printf(" %d", cmd.value);
+    else if (cmd.type == CMD_WAIT)
+        printf(" %s", cmd.text);
+    printf("\n");
+}
+
+static bool encode(const char *path, ByteSink &sink, uint16_t stepsPerRotation, unsigned long &lines)
+{
+    JobFile job;
+    if (!job.open(path, stepsPerRotation))
+    {
+        return false;
+    }
+    if (job.isBinary())
+    {
+        fprintf(stderr, "%s: already a binary job\n", path);
+        return false;
+    }
+
+    EggBinaryEncoder encoder(sink, stepsPerRotation);
+    encoder.begin();
+    Command cmd;
+    lines = 0;
+    while (job.next(cmd))
+    {
+        encoder.write(cmd);
+        lines++;
+    }
+    return true;
+}
+
+// feeds the job in chunks of varying size, like upload callbacks
+static bool compile(const char *path, ByteSink &sink, uint16_t stepsPerRotation, unsigned long &lines)
+{
+    std::vector<uint8_t> data;
+    if (!readFile(path, data))
+    {
+        return false;
+    }
+
+    JobCompiler compiler(sink, stepsPerRotation);
+    compiler.begin();
+    size_t position = 0;
+    srand(data.size());
+    while (position < data.size())
+    {
+        size_t chunk = 1 + rand() % 1460;
+        if (chunk > data.size() - position)
+        {
+            chunk = data.size() - position;
+        }
+        compiler.write(&data[position], chunk);
+        position += chunk;
+    }
+    compiler.end();
+    lines = compiler.getLines();
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    uint16_t stepsPerRotation = 6400;
+    const char *args[3] = {};
+    int count = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--steps") && i + 1 < argc)
+            stepsPerRotation = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && count < 3)
+            args[count++] = argv[i];
+        else
+            usage();
+    }
+    if (count < 2)
+    {
+        usage();
+    }
+
+    if ((!strcmp(args[0], "encode") || !strcmp(args[0], "compile")) && count == 3)
+    {
+        FILE *out = fopen(args[2], "wb");
+        if (!out)
+        {
+            perror(args[2]);
+            return 1;
+        }
+        StdioSink sink(out);
+        unsigned long lines;
+        bool ok = !strcmp(args[0], "encode")
+                      ? encode(args[1], sink, stepsPerRotation, lines)
+                      : compile(args[1], sink, stepsPerRotation, lines);
+        long size = ftell(out);
+        fclose(out);
+        if (!ok)
+        {
+            return 1;
+        }
+        printf("%s: %lu lines, %ld bytes\n", args[2], lines, size);
+        return 0;
+    }
+
+    if (!strcmp(args[0], "dump") && count == 2)
+    {
+        JobFile job;
+        if (!job.open(args[1], stepsPerRotation))
+        {
+            return 1;
+        }
+        Command cmd;
+        unsigned long line = 0;
+        while (job.next(cmd))
+        {
+            printCommand(++line, cmd);
+        }
+        return 0;
+    }
+
+    if (!strcmp(args[0], "verify") && count == 2)
+    {
+        MemorySink encoded;
+        unsigned long lines;
+        if (!encode(args[1], encoded, stepsPerRotation, lines))
+        {
+            return 1;
+        }
+
+        JobFile text;
+        text.open(args[1], stepsPerRotation);
+        MemorySource source(encoded.data);
+        BinaryJobReader binary(source, stepsPerRotation);
+        if (!binary.begin())
+        {
+            printf("%s: invalid header\n", args[1]);
+            return 2;
+        }
+
+        Command expected, actual;
+        unsigned long line = 0;
+        while (text.next(expected))
+        {
+            line++;
+            if (!binary.next(actual) || !sameCommand(expected, actual))
+            {
+                printf("%s: line %lu differs\n", args[1], line);
+                printCommand(line, expected);
+                printCommand(line, actual);
+                return 2;
+            }
+        }
+        if (binary.next(actual))
+        {
+            printf("%s: binary job has extra lines\n", args[1]);
+            return 2;
+        }
+
+        MemorySink compiled;
+        compile(args[1], compiled, stepsPerRotation, lines);
+        if (compiled.data != encoded.data)
+        {
+            printf("%s: compiled job differs from the encoded one\n", args[1]);
+            return 2;
+        }
+
+        printf("%s: %lu lines match, %zu -> %zu bytes\n", args[1], line, text.size(), encoded.data.size());
+        return 0;
+    }
+
+    usage();
+}
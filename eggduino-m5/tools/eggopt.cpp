@@ -0,0 +1,156 @@
+// Reorders the segments of text jobs with the firmware's travel optimizer
+// and reports pen-up travel (steps, the way the printer goes round the
+// egg) and estimated print time before and after. With -o, the optimised copy of a single job is written out.
+//
+// g++ -std=c++11 -O2 -Isrc tools/eggopt.cpp src/command.cpp src/jobreader.cpp src/traveloptimizer.cpp src/estimator.cpp src/pathfilter.cpp src/planner.cpp src/strokespeed.cpp -o eggopt
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "estimator.h"
+#include "hostio.h"
+#include "jobreader.h"
+#include "traveloptimizer.h"
+#include "wrap.h"
+
+struct JobStats
+{
+    double travel, draw;
+    uint32_t penLifts;
+    float seconds;
+};
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: eggopt [options] job...\n"
+            "  --steps N      steps per rotation (6400)\n"
+            "  -o FILE        write the optimised job (one job only)\n");
+    exit(1);
+}
+
+static JobStats measure(const std::vector<uint8_t> &data, const MotionParameters &params)
+{
+    MemorySource source(data);
+    TextJobReader reader(source, params.stepsPerRotation);
+    JobEstimator estimator(params);
+    JobStats stats = {};
+    int32_t x = 0, y = 0;
+    bool penUp = true;
+    RotationWrap wrap;
+    wrap.begin(params.stepsPerRotation);
+    auto moveTo = [&](int32_t toX, int32_t toY, bool shortest) {
+        toX = wrap.map(toX, x, shortest);
+        (penUp ? stats.travel : stats.draw) += hypot(toX - x, toY - y);
+        x = toX;
+        y = toY;
+    };
+
+    Command cmd;
+    while (reader.next(cmd))
+    {
+        estimator.add(cmd);
+        switch (cmd.type)
+        {
+        case CMD_MOVE:
+            moveTo(cmd.x, cmd.y, penUp || params.wrapDrawing);
+            break;
+        case CMD_PEN_UP:
+            stats.penLifts += !penUp;
+            penUp = true;
+            break;
+        case CMD_PEN_DOWN:
+            penUp = false;
+            break;
+        case CMD_WAIT:
+        {
+            int32_t pen = y;
+            moveTo(wrap.unmap(x), 0, false);
+            moveTo(wrap.unmap(x), pen, false);
+            break;
+        }
+        case CMD_HOME:
+            moveTo(0, 0, true);
+            x = 0;
+            wrap.reset();
+            break;
+        default:
+            break;
+        }
+    }
+    stats.seconds = estimator.end();
+    return stats;
+}
+
+int main(int argc, char **argv)
+{
+    MotionParameters params;
+    getDefaultParameters(params);
+    const char *outPath = NULL;
+    int first = 1;
+    for (; first < argc && argv[first][0] == '-'; first++)
+    {
+        if (first + 1 >= argc)
+            usage();
+        if (!strcmp(argv[first], "--steps"))
+            params.stepsPerRotation = atoi(argv[++first]);
+        else if (!strcmp(argv[first], "-o"))
+            outPath = argv[++first];
+        else
+            usage();
+    }
+    if (first >= argc || (outPath && first + 1 != argc))
+    {
+        usage();
+    }
+
+    printf("%-16s %8s %8s %12s %12s %7s %9s %9s\n", "job", "segments", "reversed",
+           "travel", "optimised", "saved", "time s", "optimised");
+    int result = 0;
+    for (int i = first; i < argc; i++)
+    {
+        std::vector<uint8_t> data;
+        if (!readFile(argv[i], data))
+        {
+            result = 1;
+            continue;
+        }
+
+        MemorySource source(data);
+        MemorySink sink;
+        TravelOptimizer optimizer(source, sink, params.stepsPerRotation);
+        if (!optimizer.run())
+        {
+            fprintf(stderr, "%s: could not optimise\n", argv[i]);
+            result = 1;
+            continue;
+        }
+
+        JobStats before = measure(data, params), after = measure(sink.data, params);
+        if (before.penLifts != after.penLifts || fabs(before.draw - after.draw) > 1 + before.draw * 1e-6)
+        {
+            fprintf(stderr, "%s: the optimised job draws something else\n", argv[i]);
+            result = 1;
+        }
+        printf("%-16s %8u %8u %12.0f %12.0f %6.1f%% %9.0f %9.0f\n", argv[i], optimizer.getSegments(),
+               optimizer.getReversed(), before.travel, after.travel,
+               before.travel ? 100 * (1 - after.travel / before.travel) : 0, before.seconds, after.seconds);
+
+        if (outPath)
+        {
+            FILE *out = fopen(outPath, "wb");
+            if (!out || fwrite(sink.data.data(), 1, sink.data.size(), out) != sink.data.size())
+            {
+                perror(outPath);
+                result = 1;
+            }
+            if (out)
+            {
+                fclose(out);
+            }
+        }
+    }
+    return result;
+}
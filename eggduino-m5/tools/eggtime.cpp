@@ -0,0 +1,85 @@
+// Prints the predicted print time of jobs, using the same estimator the
+// firmware uses for progress and ETA.
+//
+// g++ -std=c++11 -O2 -Isrc tools/eggtime.cpp src/command.cpp src/jobreader.cpp src/eggbin.cpp src/pathfilter.cpp src/planner.cpp src/strokespeed.cpp src/estimator.cpp -o eggtime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "estimator.h"
+#include "hostjob.h"
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: eggtime [options] job...\n"
+            "  --steps N      steps per rotation (6400)\n"
+            "  --draw N       drawing speed, steps/s (500)\n"
+            "  --travel N     travel speed, steps/s (2000)\n"
+            "  --accel N      acceleration, steps/s^2 (4000)\n"
+            "  --junction N   cornering deviation, steps (2)\n"
+            "  --start N      start speed, steps/s (2000)\n"
+            "  --pen-delay N  pen lift and lowering time, ms (150)\n"
+            "  --overlap N    motion during pen moves, ms (40)\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    MotionParameters params;
+    getDefaultParameters(params);
+
+    int first = 1;
+    for (; first < argc && argv[first][0] == '-'; first++)
+    {
+        if (first + 1 >= argc)
+            usage();
+        int value = atoi(argv[first + 1]);
+        if (!strcmp(argv[first], "--steps"))
+            params.stepsPerRotation = value;
+        else if (!strcmp(argv[first], "--draw"))
+            params.drawingSpeed = value;
+        else if (!strcmp(argv[first], "--travel"))
+            params.travelSpeed = value;
+        else if (!strcmp(argv[first], "--accel"))
+            params.acceleration = value;
+        else if (!strcmp(argv[first], "--junction"))
+            params.junctionDeviation = value;
+        else if (!strcmp(argv[first], "--start"))
+            params.startSpeed = value;
+        else if (!strcmp(argv[first], "--pen-delay"))
+            params.penUpDelay = params.penDownDelay = value;
+        else if (!strcmp(argv[first], "--overlap"))
+            params.penOverlap = value;
+        else
+            usage();
+        first++;
+    }
+    if (first >= argc)
+    {
+        usage();
+    }
+
+    int result = 0;
+    for (int i = first; i < argc; i++)
+    {
+        JobFile job;
+        if (!job.open(argv[i], params.stepsPerRotation))
+        {
+            result = 1;
+            continue;
+        }
+
+        JobEstimator estimator(params);
+        Command cmd;
+        while (job.next(cmd))
+        {
+            estimator.add(cmd);
+        }
+        unsigned long seconds = estimator.end() + .5f;
+        printf("%s\t%lu lines\t%lu:%02lu:%02lu\t%lu s\n", argv[i], estimator.getLines(),
+               seconds / 3600, seconds / 60 % 60, seconds % 60, seconds);
+    }
+    return result;
+}
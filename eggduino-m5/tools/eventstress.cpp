@@ -0,0 +1,142 @@
+// Hammers the printer event queue from two threads, like the print task and
+// the web loop on the two cores, and checks nothing is lost, duplicated or
+// reordered. Also runs the plain SPSC queue at full speed.
+//
+// g++ -std=c++11 -O2 -pthread -Isrc tools/eventstress.cpp -o eventstress
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#include "events.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds(Clock::time_point since)
+{
+    return std::chrono::duration<double>(Clock::now() - since).count();
+}
+
+// every item pushed is received exactly once and in order
+static bool queueStress(uint32_t count)
+{
+    SpscQueue<uint32_t, 256> queue;
+    uint32_t errors = 0, received = 0;
+    auto start = Clock::now();
+
+    std::thread consumer([&]() {
+        uint32_t expected = 0, value;
+        while (expected < count)
+        {
+            if (queue.pop(value))
+            {
+                if (value != expected)
+                {
+                    errors++;
+                }
+                expected = value + 1;
+                received++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (uint32_t i = 0; i < count;)
+    {
+        if (queue.push(i))
+        {
+            i++;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+
+    double time = seconds(start);
+    printf("queue     %u items  %8.3f s  %6.1f M items/s  %u out of order\n",
+           received, time, received / time / 1e6, errors);
+    return !errors && received == count;
+}
+
+// progress is never reordered and every one pushed is received or counted as
+// dropped; status changes from a third thread are never lost entirely
+static bool eventStress(uint32_t count)
+{
+    PrinterEvents events;
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> statusPushed(0);
+    uint32_t progress = 0, statuses = 0, errors = 0;
+    auto start = Clock::now();
+
+    std::thread consumer([&]() {
+        PrinterEvent event;
+        uint32_t last = 0;
+        bool finished = false;
+        while (!finished)
+        {
+            finished = done.load(std::memory_order_acquire);
+            while (events.pop(event))
+            {
+                if (event.type == EVENT_STATUS)
+                {
+                    statuses++;
+                    continue;
+                }
+                if (event.lines <= last || event.percent != event.lines % 101 ||
+                    event.remainingSeconds != ~event.lines)
+                {
+                    errors++;
+                }
+                last = event.lines;
+                progress++;
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    std::thread status([&]() {
+        while (!done.load(std::memory_order_acquire))
+        {
+            events.pushStatus();
+            statusPushed++;
+            std::this_thread::yield();
+        }
+    });
+
+    uint32_t lastDropped = 0;
+    for (uint32_t i = 1; i <= count; i++)
+    {
+        events.pushProgress(i, i % 101, ~i);
+        // let the consumer catch up, like the print task does between events
+        if (events.getDropped() != lastDropped)
+        {
+            lastDropped = events.getDropped();
+            std::this_thread::yield();
+        }
+    }
+    done.store(true, std::memory_order_release);
+    status.join();
+    consumer.join();
+
+    double time = seconds(start);
+    uint32_t dropped = events.getDropped();
+    printf("events    %u progress  %u dropped  %u of %u status  %8.3f s  %u corrupt\n",
+           progress, dropped, statuses, statusPushed.load(), time, errors);
+    return !errors && progress + dropped == count && (statusPushed == 0 || statuses > 0);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t count = argc > 1 ? atoi(argv[1]) : 1000000;
+    bool ok = queueStress(count);
+    ok = eventStress(count) && ok;
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 2;
+}
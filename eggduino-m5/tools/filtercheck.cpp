@@ -0,0 +1,301 @@
+// Checks the firmware's path filter: feeds it generated polylines (tiny
+// noisy moves, repeats, spikes, like traced images give) and any jobs
+// given, the way the printer does, and verifies that every move left out
+// is within the tolerance of the path the printer takes instead. For jobs
+// it also reports the moves left out and the estimated time saved.
+//
+// g++ -std=c++11 -O2 -Isrc -Itools tools/filtercheck.cpp src/command.cpp src/jobreader.cpp src/eggbin.cpp src/pathfilter.cpp src/planner.cpp src/strokespeed.cpp src/estimator.cpp -o filtercheck
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "estimator.h"
+#include "hostjob.h"
+#include "pathfilter.h"
+
+struct Point
+{
+    int32_t x, y;
+    bool operator==(const Point &other) const { return x == other.x && y == other.y; }
+};
+
+// follows a PathFilter and checks each run of moves when it is flushed
+class FilterCheck
+{
+public:
+    FilterCheck(uint16_t tolerance) : failures(0), moves(0), kept(0), tolerance(tolerance)
+    {
+        filter.begin(tolerance, 0, 0);
+        added.push_back({0, 0});
+    }
+
+    void add(int32_t x, int32_t y)
+    {
+        moves++;
+        filter.add(x, y);
+        // a repeat goes nowhere, it is on the path whatever is kept
+        if (!(added.back() == Point{x, y}))
+        {
+            added.push_back({x, y});
+        }
+        take();
+    }
+
+    void flush()
+    {
+        filter.flush();
+        take();
+        if (!filter.isEmpty())
+        {
+            fail("moves held back after a flush");
+        }
+        verify();
+    }
+
+    void setPosition(int32_t x, int32_t y)
+    {
+        filter.setPosition(x, y);
+        added.assign(1, {x, y});
+    }
+
+    uint32_t failures, moves, kept;
+    PathFilter filter;
+
+private:
+    void take()
+    {
+        int32_t x, y;
+        while (filter.next(x, y))
+        {
+            made.push_back({x, y});
+            kept++;
+        }
+    }
+
+    // the moves made are some of those added, in order, ending with the
+    // last; the ones in between are close to the straight move made over
+    // them. A path can come back to where it was, so every place a move
+    // made could stand for is followed
+    void verify()
+    {
+        std::vector<size_t> from(1, 0), to;
+        for (const Point &point : made)
+        {
+            to.clear();
+            for (size_t at = 1; at < added.size(); at++)
+            {
+                if (!(added[at] == point))
+                {
+                    continue;
+                }
+                for (size_t start : from)
+                {
+                    if (start < at && isCovered(start, at))
+                    {
+                        to.push_back(at);
+                        break;
+                    }
+                }
+            }
+            from.swap(to);
+        }
+        if (std::find(from.begin(), from.end(), added.size() - 1) == from.end())
+        {
+            fail(from.empty() ? "move not added, or too far off it" : "last move left out");
+        }
+        added.assign(1, added.back());
+        made.clear();
+    }
+
+    bool isCovered(size_t from, size_t to) const
+    {
+        for (size_t i = from + 1; i < to; i++)
+        {
+            if (distance(added[from], added[to], added[i]) > tolerance + 1e-4)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static double distance(Point a, Point b, Point p)
+    {
+        double dx = b.x - a.x, dy = b.y - a.y;
+        double t = dx || dy ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / (dx * dx + dy * dy) : 0;
+        t = t < 0 ? 0 : t > 1 ? 1 : t;
+        return hypot(p.x - a.x - t * dx, p.y - a.y - t * dy);
+    }
+
+    void fail(const char *what)
+    {
+        if (failures++ < 5)
+        {
+            fprintf(stderr, "  %s (tolerance %u)\n", what, tolerance);
+        }
+    }
+
+    uint16_t tolerance;
+    std::vector<Point> added, made;
+};
+
+static uint32_t seed = 1;
+
+static int32_t random(int32_t from, int32_t to)
+{
+    seed = seed * 1103515245 + 12345;
+    return from + (int32_t)((seed >> 8) % (uint32_t)(to - from + 1));
+}
+
+static uint32_t checkGenerated(uint32_t runs, uint16_t tolerance)
+{
+    FilterCheck check(tolerance);
+    int32_t x = 0, y = 0;
+    for (uint32_t run = 0; run < runs; run++)
+    {
+        // a curve of tiny moves with some noise, sometimes standing still or
+        // jumping out and back
+        double heading = random(0, 628) / 100.0, turn = random(-20, 20) / 1000.0;
+        for (int32_t move = random(1, 200); move > 0; move--)
+        {
+            int32_t kind = random(0, 19);
+            if (kind == 0)
+            {
+                check.add(x, y);
+                continue;
+            }
+            if (kind == 1)
+            {
+                check.add(x + random(-20, 20), y + random(-20, 20));
+                check.add(x, y);
+                continue;
+            }
+            double length = random(1, 12);
+            heading += turn;
+            x += (int32_t)lround(length * cos(heading)) + random(-1, 1);
+            y += (int32_t)lround(length * sin(heading)) + random(-1, 1);
+            check.add(x, y);
+        }
+        check.flush();
+        if (random(0, 9) == 0)
+        {
+            x = y = 0;
+            check.setPosition(0, 0);
+        }
+    }
+    if (check.moves != check.kept + check.filter.getMerged() + check.filter.getSimplified())
+    {
+        fprintf(stderr, "  moves not accounted for (tolerance %u)\n", tolerance);
+        check.failures++;
+    }
+    printf("generated, tolerance %u: %u moves, %u made, %u merged, %u simplified, %u failures\n",
+           tolerance, check.moves, check.kept, check.filter.getMerged(), check.filter.getSimplified(), check.failures);
+    return check.failures;
+}
+
+static float estimate(const char *path, const MotionParameters &params)
+{
+    JobFile job;
+    if (!job.open(path, params.stepsPerRotation))
+    {
+        return 0;
+    }
+    JobEstimator estimator(params);
+    Command cmd;
+    while (job.next(cmd))
+    {
+        estimator.add(cmd);
+    }
+    return estimator.end();
+}
+
+static uint32_t checkJob(const char *path, const MotionParameters &params)
+{
+    JobFile job;
+    if (!job.open(path, params.stepsPerRotation))
+    {
+        return 1;
+    }
+    FilterCheck check(params.pathTolerance);
+    uint32_t lines = 0;
+    Command cmd;
+    while (job.next(cmd))
+    {
+        lines++;
+        if (cmd.type == CMD_MOVE)
+        {
+            check.add(cmd.x, cmd.y);
+        }
+        else if (cmd.type != CMD_PROGRESS && cmd.type != CMD_NONE)
+        {
+            check.flush();
+            if (cmd.type == CMD_HOME)
+            {
+                check.setPosition(0, 0);
+            }
+        }
+    }
+    check.flush();
+
+    MotionParameters unfiltered = params;
+    unfiltered.pathTolerance = 0;
+    float before = estimate(path, unfiltered), after = estimate(path, params);
+    printf("%s: %u lines, %u moves, %u merged, %u simplified, %.0f s -> %.0f s, %u failures\n",
+           path, lines, check.moves, check.filter.getMerged(), check.filter.getSimplified(),
+           before, after, check.failures);
+    return check.failures;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: filtercheck [options] [job...]\n"
+            "  --steps N      steps per rotation (6400)\n"
+            "  --tolerance N  path tolerance for jobs, steps (1)\n"
+            "  --runs N       generated polylines per tolerance (20000)\n"
+            "  --seed N       for the generated polylines (1)\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    MotionParameters params;
+    getDefaultParameters(params);
+    uint32_t runs = 20000;
+
+    int first = 1;
+    for (; first < argc && argv[first][0] == '-'; first++)
+    {
+        if (first + 1 >= argc)
+            usage();
+        int value = atoi(argv[first + 1]);
+        if (!strcmp(argv[first], "--steps"))
+            params.stepsPerRotation = value;
+        else if (!strcmp(argv[first], "--tolerance"))
+            params.pathTolerance = value;
+        else if (!strcmp(argv[first], "--runs"))
+            runs = value;
+        else if (!strcmp(argv[first], "--seed"))
+            seed = value;
+        else
+            usage();
+        first++;
+    }
+
+    uint32_t failures = 0;
+    const uint16_t tolerances[] = {0, 1, 2, 5, 20};
+    for (uint16_t tolerance : tolerances)
+    {
+        failures += checkGenerated(runs, tolerance);
+    }
+    for (int i = first; i < argc; i++)
+    {
+        failures += checkJob(argv[i], params);
+    }
+    printf(failures ? "FAILED\n" : "ok\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,154 @@
+// Compares jobs as plain text and gzip compressed (.egg.gz): the upload
+// size, how fast the printer's inflater unpacks them and how fast they
+// parse either way. Compresses with zlib at its best level like
+// `gzip -9`, then checks the inflater gives back every byte.
+//
+// g++ -std=c++11 -O2 -Isrc -Itools tools/gzbench.cpp src/command.cpp src/gzipsource.cpp src/jobreader.cpp -lz -o gzbench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <zlib.h>
+
+#include "gzipsource.h"
+#include "hostio.h"
+#include "jobreader.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// at least this long per measurement, repeating the job as needed
+#define MIN_SECONDS 0.2
+
+static bool compress(const std::vector<uint8_t> &data, std::vector<uint8_t> &compressed)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    // 15 window bits plus 16 for a gzip wrapper
+    if (deflateInit2(&stream, 9, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return false;
+    }
+    compressed.resize(deflateBound(&stream, data.size()));
+    stream.next_in = (Bytef *)data.data();
+    stream.avail_in = data.size();
+    stream.next_out = compressed.data();
+    stream.avail_out = compressed.size();
+    bool done = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+    return done;
+}
+
+static unsigned long parse(ByteSource &source)
+{
+    TextJobReader reader(source, 6400);
+    Command cmd;
+    unsigned long lines = 0;
+    while (reader.next(cmd))
+    {
+        lines++;
+    }
+    return lines;
+}
+
+// seconds per run of what, repeated for at least MIN_SECONDS
+template <typename Run>
+static double timed(Run what)
+{
+    unsigned runs = 0;
+    auto start = Clock::now();
+    double seconds;
+    do
+    {
+        what();
+        runs++;
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (seconds < MIN_SECONDS);
+    return seconds / runs;
+}
+
+static bool inflatesBack(const std::vector<uint8_t> &data, const std::vector<uint8_t> &compressed)
+{
+    MemorySource memory(compressed);
+    GzipSource gzip(memory);
+    if (!gzip.begin())
+    {
+        return false;
+    }
+    std::vector<uint8_t> inflated;
+    uint8_t buffer[700];
+    size_t read;
+    while ((read = gzip.read(buffer, sizeof(buffer))) > 0)
+    {
+        inflated.insert(inflated.end(), buffer, buffer + read);
+    }
+    return gzip.isComplete() && inflated == data;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: gzbench job.egg...\n");
+        return 1;
+    }
+
+    printf("%-14s %9s %9s %6s %10s %10s %10s\n",
+           "job", "bytes", "gz bytes", "ratio", "inflate", "parse", "gz parse");
+    printf("%-14s %9s %9s %6s %10s %10s %10s\n",
+           "", "", "", "", "MB/s", "lines/s", "lines/s");
+    bool ok = true;
+    size_t totalPlain = 0, totalCompressed = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::vector<uint8_t> data, compressed;
+        if (!readFile(argv[i], data))
+        {
+            return 1;
+        }
+        if (!compress(data, compressed))
+        {
+            fprintf(stderr, "%s: compression failed\n", argv[i]);
+            return 1;
+        }
+        if (!inflatesBack(data, compressed))
+        {
+            printf("%s: INFLATED DIFFERENTLY\n", argv[i]);
+            ok = false;
+            continue;
+        }
+
+        unsigned long lines = 0;
+        double plainTime = timed([&]() {
+            MemorySource memory(data);
+            lines = parse(memory);
+        });
+        double inflateTime = timed([&]() {
+            MemorySource memory(compressed);
+            GzipSource gzip(memory);
+            gzip.begin();
+            uint8_t buffer[512];
+            while (gzip.read(buffer, sizeof(buffer)) > 0)
+            {
+            }
+        });
+        double compressedTime = timed([&]() {
+            MemorySource memory(compressed);
+            GzipSource gzip(memory);
+            gzip.begin();
+            parse(gzip);
+        });
+
+        const char *name = strrchr(argv[i], '/');
+        printf("%-14s %9zu %9zu %5.1f%% %10.1f %10.0f %10.0f\n",
+               name ? name + 1 : argv[i], data.size(), compressed.size(),
+               compressed.size() * 100.0 / data.size(), data.size() / inflateTime / 1e6,
+               lines / plainTime, lines / compressedTime);
+        totalPlain += data.size();
+        totalCompressed += compressed.size();
+    }
+    printf("total %zu bytes, %zu compressed (%.1f%%)\n",
+           totalPlain, totalCompressed, totalCompressed * 100.0 / (totalPlain ? totalPlain : 1));
+    return ok ? 0 : 2;
+}
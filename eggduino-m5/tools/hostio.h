@@ -0,0 +1,92 @@
+#ifndef HOSTIO_H
+#define HOSTIO_H
+
+// ByteSource/ByteSink adapters for the host tools
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "bytestream.h"
+
+class StdioSource : public ByteSource
+{
+public:
+    StdioSource(FILE *file) : file(file) {}
+    size_t read(uint8_t *buffer, size_t length) override { return fread(buffer, 1, length, file); }
+
+private:
+    FILE *file;
+};
+
+class StdioSink : public ByteSink
+{
+public:
+    StdioSink(FILE *file) : file(file) {}
+    size_t write(const uint8_t *buffer, size_t length) override { return fwrite(buffer, 1, length, file); }
+
+private:
+    FILE *file;
+};
+
+class MemorySource : public SeekableSource
+{
+public:
+    MemorySource(const std::vector<uint8_t> &data) : data(data), position(0) {}
+    size_t read(uint8_t *buffer, size_t length) override
+    {
+        if (length > data.size() - position)
+        {
+            length = data.size() - position;
+        }
+        memcpy(buffer, data.data() + position, length);
+        position += length;
+        return length;
+    }
+
+    bool seek(uint32_t offset) override
+    {
+        if (offset > data.size())
+        {
+            return false;
+        }
+        position = offset;
+        return true;
+    }
+
+private:
+    const std::vector<uint8_t> &data;
+    size_t position;
+};
+
+class MemorySink : public ByteSink
+{
+public:
+    size_t write(const uint8_t *buffer, size_t length) override
+    {
+        data.insert(data.end(), buffer, buffer + length);
+        return length;
+    }
+
+    std::vector<uint8_t> data;
+};
+
+static inline bool readFile(const char *path, std::vector<uint8_t> &data)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        perror(path);
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        data.insert(data.end(), buffer, buffer + read);
+    }
+    fclose(file);
+    return true;
+}
+
+#endif
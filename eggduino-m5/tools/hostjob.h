@@ -0,0 +1,53 @@
+#ifndef HOSTJOB_H
+#define HOSTJOB_H
+
+// loads a text or binary job into memory and reads it like the printer does
+
+#include <memory>
+
+#include "eggbin.h"
+#include "hostio.h"
+#include "jobreader.h"
+
+class JobFile
+{
+public:
+    bool open(const char *path, uint16_t stepsPerRotation)
+    {
+        data.clear();
+        if (!readFile(path, data))
+        {
+            return false;
+        }
+
+        source.reset(new MemorySource(data));
+        binary = isEggBinaryHeader(data.data(), data.size());
+        if (binary)
+        {
+            BinaryJobReader *binaryReader = new BinaryJobReader(*source, stepsPerRotation);
+            reader.reset(binaryReader);
+            if (!binaryReader->begin())
+            {
+                fprintf(stderr, "%s: invalid binary job header\n", path);
+                return false;
+            }
+        }
+        else
+        {
+            reader.reset(new TextJobReader(*source, stepsPerRotation));
+        }
+        return true;
+    }
+
+    bool next(Command &cmd) { return reader->next(cmd); }
+    bool isBinary() const { return binary; }
+    size_t size() const { return data.size(); }
+
+private:
+    std::vector<uint8_t> data;
+    std::unique_ptr<MemorySource> source;
+    std::unique_ptr<JobReader> reader;
+    bool binary = false;
+};
+
+#endif
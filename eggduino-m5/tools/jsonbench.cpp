@@ -0,0 +1,178 @@
+// Checks the JSON writer against known output (escaping, nesting, overflow,
+// chunked continuation) and times it against snprintf and string
+// concatenation for a status message and a file list.
+//
+// g++ -std=c++11 -O2 -Isrc tools/jsonbench.cpp src/jsonwriter.cpp -o jsonbench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
+#include "jsonwriter.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static int failures = 0;
+
+static void expect(const char *name, const char *actual, const char *expected)
+{
+    if (strcmp(actual, expected))
+    {
+        printf("FAIL %s\n  got      %s\n  expected %s\n", name, actual, expected);
+        failures++;
+    }
+}
+
+static void check()
+{
+    char buff[200];
+    {
+        JsonWriter json(buff, sizeof(buff));
+        json.beginObject()
+            .member("a", 1)
+            .member("b", -2147483647L - 1)
+            .member("c", 4294967295UL)
+            .member("d", true)
+            .member("e", "text")
+            .key("f")
+            .null()
+            .key("g")
+            .beginArray()
+            .value(0)
+            .beginObject()
+            .endObject()
+            .beginArray()
+            .endArray()
+            .value(false)
+            .endArray()
+            .endObject();
+        expect("types", buff, "{\"a\":1,\"b\":-2147483648,\"c\":4294967295,\"d\":true,\"e\":\"text\",\"f\":null,"
+                              "\"g\":[0,{},[],false]}");
+    }
+    {
+        JsonWriter json(buff, sizeof(buff));
+        json.beginObject().member("q\"", "a\"b\\c\nd\re\tf\x01g\x1f\xc3\xa9").endObject();
+        expect("escape", buff, "{\"q\\\"\":\"a\\\"b\\\\c\\nd\\re\\tf\\u0001g\\u001f\xc3\xa9\"}");
+    }
+    {
+        JsonWriter json(buff, sizeof(buff));
+        json.beginArray().value("abcdef", 3).endArray();
+        expect("length", buff, "[\"abc\"]");
+    }
+    {
+        char small[8];
+        JsonWriter json(small, sizeof(small));
+        json.beginArray().value(1234);
+        auto saved = json.save();
+        json.value(5678).endArray();
+        if (!json.overflowed())
+        {
+            printf("FAIL overflow not reported\n");
+            failures++;
+        }
+        expect("overflow", small, "[1234,");
+        json.restore(saved);
+        expect("restore", small, "[1234");
+        if (json.overflowed())
+        {
+            printf("FAIL restore keeps overflow\n");
+            failures++;
+        }
+    }
+    {
+        // a document split over two buffers, like a chunked response
+        char first[20], second[20];
+        JsonWriter json(first, sizeof(first));
+        json.beginArray().beginObject().member("x", 1);
+        JsonWriter rest(second, sizeof(second), json.save());
+        rest.member("y", 2).endObject().value(3).endArray();
+        std::string joined = std::string(first) + second;
+        expect("chunks", joined.c_str(), "[{\"x\":1,\"y\":2},3]");
+    }
+}
+
+template <typename F>
+static double time(uint32_t count, F run)
+{
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        run(i);
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count() / count * 1e9;
+}
+
+static volatile size_t sink;
+
+int main(int argc, char **argv)
+{
+    check();
+    printf("%s\n", failures ? "checks FAILED" : "checks ok");
+
+    uint32_t count = argc > 1 ? atoi(argv[1]) : 200000;
+    char buff[300];
+
+    double writer = time(count, [&](uint32_t i) {
+        JsonWriter json(buff, sizeof(buff));
+        json.beginObject()
+            .member("status", "printing")
+            .member("fileName", "flowers/big egg")
+            .member("progress", i)
+            .member("percent", i % 100)
+            .member("eta", 3600 - i % 3600)
+            .member("duration", 7200)
+            .member("readAhead", 8192)
+            .member("readStalls", 3)
+            .endObject();
+        sink = json.length();
+    });
+    double formatted = time(count, [&](uint32_t i) {
+        sink = snprintf(buff, sizeof(buff), "{\"status\":\"printing\",\"fileName\":\"%s\",\"progress\":%u,"
+                                            "\"percent\":%u,\"eta\":%u,\"duration\":%u,\"readAhead\":%u,\"readStalls\":%u}",
+                        "flowers/big egg", i, i % 100, 3600 - i % 3600, 7200, 8192, 3);
+    });
+    printf("status    writer %6.0f ns  snprintf %6.0f ns\n", writer, formatted);
+
+    const int files = 100;
+    count /= 20;
+    double writerList = time(count, [&](uint32_t) {
+        char chunk[1024];
+        JsonWriter json(chunk, sizeof(chunk));
+        size_t total = 0;
+        json.beginArray();
+        for (int f = 0; f < files; f++)
+        {
+            auto saved = json.save();
+            json.beginObject().member("name", "some egg design").endObject();
+            if (json.overflowed())
+            {
+                // send the chunk and continue in a new one
+                json.restore(saved);
+                total += json.length();
+                json = JsonWriter(chunk, sizeof(chunk), json.save());
+                f--;
+            }
+        }
+        json.endArray();
+        sink = total + json.length();
+    });
+    double concat = time(count, [&](uint32_t) {
+        std::string output = "[";
+        for (int f = 0; f < files; f++)
+        {
+            if (output != "[")
+            {
+                output += ',';
+            }
+            output += "{\"name\":\"";
+            output += std::string("some egg design.egg").substr(0, 15);
+            output += "\"}";
+        }
+        output += "]";
+        sink = output.size();
+    });
+    printf("%d files writer %6.0f ns  concat   %6.0f ns\n", files, writerList, concat);
+    return failures ? 2 : 0;
+}
@@ -0,0 +1,124 @@
+// Compares reading a job straight from its source with reading it through
+// the double buffered BlockReader fed by a separate thread. The source can
+// simulate SD card latency and every line can simulate motion work.
+//
+// g++ -std=c++11 -O2 -pthread -Isrc tools/readbench.cpp src/blockreader.cpp src/command.cpp src/jobreader.cpp -o readbench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#include "blockreader.h"
+#include "hostio.h"
+#include "jobreader.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// every read call costs a fixed latency, like a SD card transaction
+class SlowSource : public ByteSource
+{
+public:
+    SlowSource(const std::vector<uint8_t> &data, uint32_t latency) : memory(data), latency(latency) {}
+    size_t read(uint8_t *buffer, size_t length) override
+    {
+        if (latency)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(latency));
+        }
+        reads++;
+        return memory.read(buffer, length);
+    }
+
+    unsigned long reads = 0;
+
+private:
+    MemorySource memory;
+    uint32_t latency;
+};
+
+static void work(uint32_t micros)
+{
+    auto until = Clock::now() + std::chrono::microseconds(micros);
+    while (Clock::now() < until)
+    {
+    }
+}
+
+static double seconds(Clock::time_point since)
+{
+    return std::chrono::duration<double>(Clock::now() - since).count();
+}
+
+static unsigned long readLines(ByteSource &source, uint32_t lineWork)
+{
+    TextJobReader reader(source, 6400);
+    Command cmd;
+    unsigned long lines = 0;
+    while (reader.next(cmd))
+    {
+        lines++;
+        work(lineWork);
+    }
+    return lines;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: readbench [options] job\n"
+            "  --latency N  microseconds per source read (200)\n"
+            "  --work N     microseconds of work per line (20)\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t latency = 200, lineWork = 20;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--latency") && i + 1 < argc)
+            latency = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--work") && i + 1 < argc)
+            lineWork = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && !path)
+            path = argv[i];
+        else
+            usage();
+    }
+    if (!path)
+    {
+        usage();
+    }
+
+    std::vector<uint8_t> data;
+    if (!readFile(path, data))
+    {
+        return 1;
+    }
+
+    SlowSource direct(data, latency);
+    auto start = Clock::now();
+    unsigned long lines = readLines(direct, lineWork);
+    double directTime = seconds(start);
+
+    SlowSource blocks(data, latency);
+    BlockReader blockReader(blocks, []() { std::this_thread::sleep_for(std::chrono::microseconds(100)); });
+    if (!blockReader.begin())
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    start = Clock::now();
+    std::thread filler([&]() { blockReader.fill(); });
+    readLines(blockReader, lineWork);
+    double blockTime = seconds(start);
+    filler.join();
+
+    printf("%s: %zu bytes, %lu lines\n", path, data.size(), lines);
+    printf("direct    %8.3f s  %9.0f lines/s  %6lu reads\n", directTime, lines / directTime, direct.reads);
+    printf("blocks    %8.3f s  %9.0f lines/s  %6lu reads  %u stalls\n", blockTime, lines / blockTime, blocks.reads, blockReader.getStalls());
+    return 0;
+}
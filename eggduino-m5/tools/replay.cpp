@@ -0,0 +1,266 @@
+// Replays an .egg job through the motion planner and step generator on the
+// host (the step interrupt is driven by a simulated timer) and compares it
+// against running every move at constant speed (MultiStepper behaviour).
+//
+// g++ -std=c++11 -O2 -Isrc tools/replay.cpp src/planner.cpp src/command.cpp src/stepgen.cpp src/jobreader.cpp src/eggbin.cpp -o replay
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "command.h"
+#include "hostjob.h"
+#include "planner.h"
+#include "stepgen.h"
+
+struct Options
+{
+    uint16_t stepsPerRotation = 6400;
+    float drawingSpeed = 500;
+    float travelSpeed = 2000;
+    float acceleration = 4000;
+    float junctionDeviation = 2;
+    float startSpeed = 2000;
+    float penMoveDelay = 150;
+    float lineOverhead = 1;
+};
+
+struct Totals
+{
+    double motionTime = 0;
+    double penTime = 0;
+    double idleTime = 0;
+    uint64_t steps = 0;
+    float peakRate = 0;
+};
+
+class Replay
+{
+public:
+    Replay(const Options &options) : options(options)
+    {
+        planner.setAcceleration(options.acceleration);
+        planner.setJunctionDeviation(options.junctionDeviation);
+        planner.setStartSpeed(options.startSpeed);
+    }
+
+    // the print task yields for a tick after every line it reads;
+    // with the planner only when nothing is queued
+    void lineRead()
+    {
+        baseline.idleTime += options.lineOverhead / 1000.0;
+        if (planner.isEmpty())
+        {
+            planned.idleTime += options.lineOverhead / 1000.0;
+        }
+    }
+
+    void execute(const Command &cmd)
+    {
+        if (cmd.type == CMD_MOVE)
+        {
+            moveTo(cmd.x, cmd.y);
+            return;
+        }
+        if (cmd.type == CMD_NONE || cmd.type == CMD_PROGRESS)
+        {
+            return;
+        }
+
+        finishMoves();
+        switch (cmd.type)
+        {
+        case CMD_PEN_UP:
+        case CMD_PEN_DOWN:
+            penUp = cmd.type == CMD_PEN_UP;
+            baseline.penTime += options.penMoveDelay / 1000.0;
+            planned.penTime += options.penMoveDelay / 1000.0;
+            break;
+        case CMD_WAIT:
+        {
+            int32_t pen = y;
+            moveTo(x, 0);
+            moveTo(x, pen);
+            finishMoves();
+            break;
+        }
+        case CMD_HOME:
+            moveTo(0, 0);
+            finishMoves();
+            break;
+        default:
+            break;
+        }
+    }
+
+    void finishMoves()
+    {
+        while (!planner.isEmpty())
+        {
+            runBlock(*planner.current());
+            planner.discardCurrent();
+        }
+        while (!stepQueue.isEmpty() || !stepTicker.isIdle())
+        {
+            tick();
+        }
+    }
+
+    bool positionMatches() const
+    {
+        return stepTicker.position(0) == x && stepTicker.position(1) == y;
+    }
+
+    uint32_t underruns() const { return stepTicker.getUnderruns(); }
+
+    Totals baseline, planned;
+
+private:
+    void moveTo(int32_t tx, int32_t ty)
+    {
+        float speed = penUp ? options.travelSpeed : options.drawingSpeed;
+        uint32_t steps = labs(tx - x) > labs(ty - y) ? labs(tx - x) : labs(ty - y);
+        if (steps)
+        {
+            baseline.motionTime += steps / speed;
+            baseline.steps += steps;
+            baseline.peakRate = fmaxf(baseline.peakRate, speed);
+        }
+
+        if (planner.isFull())
+        {
+            runBlock(*planner.current());
+            planner.discardCurrent();
+        }
+        planner.push(tx, ty, speed);
+        x = tx;
+        y = ty;
+    }
+
+    void runBlock(const PlannerBlock &block)
+    {
+        stepGenerator.load(block);
+        while (!stepGenerator.fill(stepQueue))
+        {
+            tick();
+        }
+    }
+
+    // one simulated timer interrupt
+    void tick()
+    {
+        uint8_t bits;
+        uint32_t interval = stepTicker.tick(stepQueue, bits);
+        if (bits & (STEP_ROTATION | STEP_PEN))
+        {
+            planned.motionTime += interval / 1000000.0;
+            planned.peakRate = fmaxf(planned.peakRate, 1000000.0f / interval);
+            planned.steps++;
+        }
+    }
+
+    const Options &options;
+    Planner planner;
+    StepGenerator stepGenerator;
+    StepQueue stepQueue;
+    StepTicker stepTicker;
+    int32_t x = 0, y = 0;
+    bool penUp = true;
+};
+
+static void printTotals(const char *name, const Totals &totals)
+{
+    double total = totals.motionTime + totals.penTime + totals.idleTime;
+    printf("%-9s total %9.1f s  motion %9.1f s  pen %8.1f s  idle %8.1f s  avg %7.0f steps/s  peak %7.0f steps/s\n",
+           name, total, totals.motionTime, totals.penTime, totals.idleTime,
+           totals.motionTime > 0 ? totals.steps / totals.motionTime : 0, totals.peakRate);
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: replay [options] job\n"
+            "  --steps N      steps per rotation (6400)\n"
+            "  --draw N       drawing speed, steps/s (500)\n"
+            "  --travel N     travel speed, steps/s (2000)\n"
+            "  --accel N      acceleration, steps/s^2 (4000)\n"
+            "  --junction N   cornering deviation, steps (2)\n"
+            "  --start N      start speed, steps/s (2000)\n"
+            "  --pen-delay N  pen move delay, ms (150)\n"
+            "  --overhead N   time lost per line read, ms (1)\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--steps") && hasValue)
+            options.stepsPerRotation = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--draw") && hasValue)
+            options.drawingSpeed = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--travel") && hasValue)
+            options.travelSpeed = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--accel") && hasValue)
+            options.acceleration = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--junction") && hasValue)
+            options.junctionDeviation = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--start") && hasValue)
+            options.startSpeed = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--pen-delay") && hasValue)
+            options.penMoveDelay = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--overhead") && hasValue)
+            options.lineOverhead = atof(argv[++i]);
+        else if (argv[i][0] != '-' && !path)
+            path = argv[i];
+        else
+            usage();
+    }
+    if (!path)
+    {
+        usage();
+    }
+
+    JobFile job;
+    if (!job.open(path, options.stepsPerRotation))
+    {
+        return 1;
+    }
+
+    Replay replay(options);
+    Command cmd;
+    unsigned long lines = 0;
+    while (job.next(cmd))
+    {
+        lines++;
+        replay.execute(cmd);
+        replay.lineRead();
+    }
+    replay.finishMoves();
+
+    printf("%s: %lu lines\n", path, lines);
+    printTotals("constant", replay.baseline);
+    printTotals("planner", replay.planned);
+
+    double before = replay.baseline.motionTime + replay.baseline.penTime + replay.baseline.idleTime;
+    double after = replay.planned.motionTime + replay.planned.penTime + replay.planned.idleTime;
+    if (after > 0)
+    {
+        printf("speedup   %.2fx\n", before / after);
+    }
+
+    if (replay.underruns())
+    {
+        printf("step queue ran empty %u times while moving\n", replay.underruns());
+    }
+    if (!replay.positionMatches())
+    {
+        printf("step positions do not match the job\n");
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+// Drives the streamed print buffer the way the websocket and the print task
+// do: a sender thread that only sends within its credit, a web loop thread
+// that hands back credit with some latency, and a reader that parses at its
+// own pace. Checks every byte arrives once and in order, that sending within
+// the credit is never refused, and that sending past it always is. Runs a
+// slow sender (small trickle, the reader waits) and a bursty one (all the
+// credit at once, then a pause).
+//
+// g++ -std=c++11 -O2 -pthread -Isrc tools/streamcheck.cpp src/streambuffer.cpp -o streamcheck
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "streambuffer.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static void pause(uint32_t us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+// the stream's bytes: text, like a job
+static uint8_t streamByte(uint32_t index)
+{
+    uint32_t x = index * 2654435761u;
+    return "T0123456789 .-\n"[(x >> 16) % 15];
+}
+
+static uint32_t nextRandom(uint32_t &seed)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+struct Sender
+{
+    const char *name;
+    // bytes per write at most, writes per burst, pause between bursts in us
+    uint32_t chunk, burst, gap;
+};
+
+static void readerWait()
+{
+    std::this_thread::yield();
+}
+
+static bool run(const Sender &sender, uint32_t total)
+{
+    StreamBuffer stream(readerWait);
+    std::atomic<uint32_t> credit(stream.begin());
+    std::atomic<bool> readerDone(false);
+    uint32_t refused = 0, corrupt = 0, received = 0, credits = 0;
+    size_t maxBuffered = 0;
+    auto start = Clock::now();
+
+    std::thread reader([&]() {
+        uint8_t buffer[512];
+        uint32_t seed = 7;
+        size_t read;
+        while ((read = stream.read(buffer, 1 + nextRandom(seed) % sizeof(buffer))) > 0)
+        {
+            for (size_t i = 0; i < read; i++)
+            {
+                if (buffer[i] != streamByte(received + i))
+                {
+                    corrupt++;
+                }
+            }
+            received += read;
+            // the print task spends time on the moves now and then
+            if (nextRandom(seed) % 8 == 0)
+            {
+                pause(nextRandom(seed) % 200);
+            }
+        }
+        readerDone = true;
+    });
+
+    std::thread web([&]() {
+        uint32_t seed = 11;
+        while (!readerDone)
+        {
+            uint32_t back = stream.takeCredit();
+            if (back)
+            {
+                // the ack takes a while to reach the sender
+                credits++;
+                pause(nextRandom(seed) % 500);
+                credit += back;
+            }
+            pause(100);
+        }
+    });
+
+    uint32_t seed = 3, sent = 0;
+    uint8_t chunk[4096];
+    while (sent < total)
+    {
+        for (uint32_t i = 0; i < sender.burst && sent < total; i++)
+        {
+            uint32_t length = 1 + nextRandom(seed) % sender.chunk;
+            length = length < total - sent ? length : total - sent;
+            while (credit < length)
+            {
+                pause(50);
+            }
+            for (uint32_t j = 0; j < length; j++)
+            {
+                chunk[j] = streamByte(sent + j);
+            }
+            if (!stream.write(chunk, length))
+            {
+                refused++;
+                continue;
+            }
+            credit -= length;
+            sent += length;
+            size_t buffered = stream.getBuffered();
+            maxBuffered = buffered > maxBuffered ? buffered : maxBuffered;
+        }
+        pause(sender.gap);
+    }
+    stream.finish();
+    reader.join();
+    web.join();
+
+    double time = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("%-7s %u bytes  %6.2f s  %4u credits  %5u stalls  max %5u buffered  %u refused  %u corrupt\n",
+           sender.name, received, time, credits, stream.getStalls(), (unsigned)maxBuffered, refused, corrupt);
+    return received == total && !refused && !corrupt && maxBuffered <= STREAM_BUFFER_SIZE;
+}
+
+// more than the credit is refused whole, and nothing after an abort is taken
+static bool overflow()
+{
+    StreamBuffer stream(readerWait);
+    static uint8_t bytes[STREAM_BUFFER_SIZE + 1];
+    uint32_t credit = stream.begin();
+    bool ok = !stream.write(bytes, credit + 1) && stream.write(bytes, credit) && !stream.write(bytes, 1);
+    uint8_t buffer[16];
+    ok = ok && stream.read(buffer, sizeof(buffer)) == sizeof(buffer) && stream.takeCredit() == 0;
+    ok = ok && stream.write(bytes, sizeof(buffer)) && !stream.write(bytes, 1);
+    stream.abort();
+    ok = ok && !stream.write(bytes, 1) && stream.read(buffer, sizeof(buffer)) == 0;
+    printf("overflow %s\n", ok ? "refused" : "NOT REFUSED");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t total = argc > 1 ? atoi(argv[1]) : 1000000;
+    const Sender senders[] = {
+        {"slow", 256, 1, 300},
+        {"bursty", 4096, 8, 20000},
+    };
+    bool ok = overflow();
+    for (auto &sender : senders)
+    {
+        ok = run(sender, total) && ok;
+    }
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 2;
+}